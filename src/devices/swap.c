@@ -1,7 +1,9 @@
 #include "devices/swap.h"
 #include "devices/block.h"
+#include "threads/malloc.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
+#include "vm/zcache.h"
 #include <bitmap.h>
 #include <debug.h>
 #include <stdio.h>
@@ -12,30 +14,55 @@ static struct block *swap_device;
 /* Pointer to a bitmap to track used swap pages */
 static struct bitmap *swap_bitmap;
 
-/* Lock that protects swap_bitmap from unsynchronised access */
+/* Pointer to a bitmap with a bit per cluster of SWAP_CLUSTER
+   slots, set while any slot of the cluster is in use */
+static struct bitmap *cluster_bitmap;
+
+/* Pointer to an array with, for each slot, the number of pages
+   sharing it beyond the first.  Processes created by fork() share
+   their parent's slots until they modify the pages */
+static unsigned short *slot_sharers;
+
+/* Lock that protects swap_bitmap, cluster_bitmap and slot_sharers
+   from unsynchronised access */
 static struct lock swap_lock;
 
 /* Number of sectors needed to store a page */
 #define PAGE_SECTORS (PGSIZE / BLOCK_SECTOR_SIZE)
 
+static void claim_slot (size_t slot);
+static void write_sectors (size_t slot, size_t cnt, const void *const pages[]);
+static void read_sectors (size_t slot, size_t cnt, void *const pages[]);
+
 /* Sets up the swap space */
 void
 swap_init (void) 
 {
+  size_t slot_cnt = 0;
+
   // locate the swap block allocated to the kernel
   swap_device = block_get_role (BLOCK_SWAP);
   if (swap_device == NULL) {
       printf ("no swap device--swap disabled\n");
-      swap_bitmap = bitmap_create (0);
   } else {
-    // create a bitmap with 1 slot per page-sized chunk of memory on the swap block
-    swap_bitmap = bitmap_create (block_size (swap_device) / PAGE_SECTORS);
+    // 1 slot per page-sized chunk of memory on the swap block
+    slot_cnt = block_size (swap_device) / PAGE_SECTORS;
   }
-  
-  if (swap_bitmap == NULL){
+
+  // create a bitmap of slots and one of whole clusters; slots past
+  // the last whole cluster are only handed out one at a time
+  swap_bitmap = bitmap_create (slot_cnt);
+  cluster_bitmap = bitmap_create (slot_cnt / SWAP_CLUSTER);
+  slot_sharers = calloc (slot_cnt > 0 ? slot_cnt : 1, sizeof *slot_sharers);
+  if (swap_bitmap == NULL || cluster_bitmap == NULL || slot_sharers == NULL){
     PANIC ("couldn't create swap bitmap");
   }
+  // a mostly-full swap map is scanned faster with a summary; it is optional
+  bitmap_enable_summary (swap_bitmap);
   lock_init (&swap_lock);
+
+  // the compressed cache in front of the device is indexed by slot
+  zcache_init (slot_cnt);
 }
 
 /* Swaps page at VADDR out of memory, returns the swap-slot used */
@@ -44,39 +71,200 @@ swap_out (const void *vaddr)
 {
   // find available swap-slot for the page to be swapped out
   lock_acquire (&swap_lock);
-  size_t slot = bitmap_scan_and_flip (swap_bitmap, 0, 1, false);
+  size_t slot = bitmap_scan (swap_bitmap, 0, 1, false);
+  if (slot != BITMAP_ERROR)
+    claim_slot (slot);
   lock_release (&swap_lock);
   if (slot == BITMAP_ERROR) 
     return BITMAP_ERROR; 
 
-  // calculate block sector from swap-slot number
-  size_t sector = slot * PAGE_SECTORS;
-  
-  // loop over each sector of the page, copying it from memory into swap
-  for (size_t i = 0; i < PAGE_SECTORS; i++)
-    block_write (swap_device, sector + i, vaddr + i * BLOCK_SECTOR_SIZE);
+  swap_write_run (slot, 1, &vaddr);
+  return slot;
+}
 
+/* Claims slot INDEX of a cluster that is entirely free, so that
+   neighbouring pages can follow it into the same cluster with
+   swap_claim().  Returns the slot claimed, or BITMAP_ERROR if no
+   cluster is free */
+size_t
+swap_claim_cluster (size_t index) 
+{
+  ASSERT (index < SWAP_CLUSTER);
+
+  lock_acquire (&swap_lock);
+  size_t cluster = bitmap_scan (cluster_bitmap, 0, 1, false);
+  size_t slot = BITMAP_ERROR;
+  if (cluster != BITMAP_ERROR) {
+    slot = cluster * SWAP_CLUSTER + index;
+    claim_slot (slot);
+  }
+  lock_release (&swap_lock);
   return slot;
 }
 
+/* Claims swap-slot SLOT if it is free, returning true if so */
+bool
+swap_claim (size_t slot) 
+{
+  bool claimed = false;
+
+  lock_acquire (&swap_lock);
+  if (slot < bitmap_size (swap_bitmap) && !bitmap_test (swap_bitmap, slot)) {
+    claim_slot (slot);
+    claimed = true;
+  }
+  lock_release (&swap_lock);
+  return claimed;
+}
+
+/* Writes the CNT pages in PAGES to the consecutive swap-slots
+   starting at SLOT, which must have been claimed.  Pages the
+   compressed cache cannot take go to the swap device, a single
+   request for each run of them */
+void
+swap_write_run (size_t slot, size_t cnt, const void *const pages[]) 
+{
+  ASSERT (cnt <= SWAP_CLUSTER);
+
+  size_t start = 0;
+  for (size_t i = 0; i <= cnt; i++) {
+    if (i < cnt && !zcache_store (slot + i, pages[i]))
+      continue;
+    if (i > start)
+      write_sectors (slot + start, i - start, pages + start);
+    start = i + 1;
+  }
+}
+
+/* Reads the consecutive swap-slots starting at SLOT into the CNT
+   pages in PAGES, keeping the slots.  Pages not in the compressed
+   cache come from the swap device, a single request for each run
+   of them.  Returns the number of pages read from the device */
+size_t
+swap_read_run (size_t slot, size_t cnt, void *const pages[]) 
+{
+  ASSERT (cnt <= SWAP_CLUSTER);
+
+  size_t start = 0, read = 0;
+  for (size_t i = 0; i <= cnt; i++) {
+    if (i < cnt && !zcache_load (slot + i, pages[i]))
+      continue;
+    if (i > start) {
+      read_sectors (slot + start, i - start, pages + start);
+      read += i - start;
+    }
+    start = i + 1;
+  }
+  return read;
+}
+
+/* Writes the CNT pages in PAGES to the swap device at the
+   consecutive swap-slots starting at SLOT with a single request */
+static void
+write_sectors (size_t slot, size_t cnt, const void *const pages[]) 
+{
+  const void *sectors[SWAP_CLUSTER * PAGE_SECTORS];
+
+  // the device takes one buffer per sector
+  for (size_t i = 0; i < cnt * PAGE_SECTORS; i++)
+    sectors[i] = (const uint8_t *) pages[i / PAGE_SECTORS]
+                 + i % PAGE_SECTORS * BLOCK_SECTOR_SIZE;
+  block_write_multiple (swap_device, slot * PAGE_SECTORS,
+                        cnt * PAGE_SECTORS, sectors);
+}
+
+/* Reads the consecutive swap-slots starting at SLOT on the swap
+   device into the CNT pages in PAGES with a single request */
+static void
+read_sectors (size_t slot, size_t cnt, void *const pages[]) 
+{
+  void *sectors[SWAP_CLUSTER * PAGE_SECTORS];
+
+  // the device takes one buffer per sector
+  for (size_t i = 0; i < cnt * PAGE_SECTORS; i++)
+    sectors[i] = (uint8_t *) pages[i / PAGE_SECTORS]
+                 + i % PAGE_SECTORS * BLOCK_SECTOR_SIZE;
+  block_read_multiple (swap_device, slot * PAGE_SECTORS,
+                       cnt * PAGE_SECTORS, sectors);
+}
+
 /* Swaps page on disk in swap-slot SLOT into memory at VADDR */
 void
 swap_in (void *vaddr, size_t slot) 
 {
-  // calculate block sector from swap-slot number
-  size_t sector = slot * PAGE_SECTORS;
-
-  // loop over each sector of the page, copying it from swap into memory
-  for (size_t i = 0; i < PAGE_SECTORS; i++)
-    block_read (swap_device, sector + i, vaddr + i * BLOCK_SECTOR_SIZE);
+  swap_read (vaddr, slot);
   
   // clear the swap-slot previously used by this page
   swap_drop (slot);
 }
 
-/* Clears the swap-slot SLOT so that it can be used for another page */
+/* Copies the page in swap-slot SLOT into memory at VADDR, keeping
+   the slot so that a clean page need not be written out again */
+void
+swap_read (void *vaddr, size_t slot) 
+{
+  swap_read_run (slot, 1, &vaddr);
+}
+
+/* Lets one more page share swap-slot SLOT, which must be in use.
+   The slot is only freed once every page sharing it has dropped
+   it */
+void
+swap_share (size_t slot) 
+{
+  lock_acquire (&swap_lock);
+  ASSERT (bitmap_test (swap_bitmap, slot));
+  slot_sharers[slot]++;
+  lock_release (&swap_lock);
+}
+
+/* Returns true if more than one page shares swap-slot SLOT, in
+   which case it must not be overwritten */
+bool
+swap_shared (size_t slot) 
+{
+  lock_acquire (&swap_lock);
+  bool shared = slot_sharers[slot] > 0;
+  lock_release (&swap_lock);
+  return shared;
+}
+
+/* Clears the swap-slot SLOT so that it can be used for another
+   page, unless other pages still share it */
 void
 swap_drop (size_t slot)
 {
+  size_t cluster = slot / SWAP_CLUSTER;
+
+  lock_acquire (&swap_lock);
+  if (slot_sharers[slot] > 0) {
+    slot_sharers[slot]--;
+    lock_release (&swap_lock);
+    return;
+  }
+  lock_release (&swap_lock);
+
+  // forget the cached copy before the slot can be handed out again
+  zcache_drop (slot);
+
+  lock_acquire (&swap_lock);
   bitmap_reset (swap_bitmap, slot);
+  // a cluster whose last slot is freed is free for clustering again
+  if (cluster < bitmap_size (cluster_bitmap)
+      && !bitmap_contains (swap_bitmap, cluster * SWAP_CLUSTER,
+                           SWAP_CLUSTER, true))
+    bitmap_reset (cluster_bitmap, cluster);
+  lock_release (&swap_lock);
+}
+
+/* Marks swap-slot SLOT and its cluster as in use.  The caller
+   must hold swap_lock */
+static void
+claim_slot (size_t slot) 
+{
+  size_t cluster = slot / SWAP_CLUSTER;
+
+  bitmap_mark (swap_bitmap, slot);
+  if (cluster < bitmap_size (cluster_bitmap))
+    bitmap_mark (cluster_bitmap, cluster);
 }
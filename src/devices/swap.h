@@ -1,11 +1,25 @@
 #ifndef DEVICES_SWAP_H
 #define DEVICES_SWAP_H 1
 
+#include <stdbool.h>
 #include <stddef.h>
 
+/* Number of swap-slots in a cluster.  Neighbouring pages of a
+   process are kept in the same cluster, so that they can be
+   written and read back with a single request. */
+#define SWAP_CLUSTER 8
+
 void swap_init (void);
 size_t swap_out (const void *vaddr);
 void swap_in (void *vaddr, size_t slot);
+void swap_read (void *vaddr, size_t slot);
 void swap_drop (size_t slot);
+void swap_share (size_t slot);
+bool swap_shared (size_t slot);
+
+size_t swap_claim_cluster (size_t index);
+bool swap_claim (size_t slot);
+void swap_write_run (size_t slot, size_t cnt, const void *const pages[]);
+size_t swap_read_run (size_t slot, size_t cnt, void *const pages[]);
 
 #endif /* devices/swap.h */
@@ -24,31 +24,114 @@ static int64_t ticks;
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
-/* List of sleeping threads put to sleep by timer_sleep() */
-static struct list timer_sleep_list;
+/* Nanoseconds per timer tick. */
+#define NS_PER_TICK (1000000000 / TIMER_FREQ)
+
+/* Ticks over which timer_calibrate() measures the TSC rate. */
+#define TSC_CALIBRATE_TICKS 8
+
+/* CPU time-stamp counter (TSC) clock, the basis of timer_ns().
+   tsc_per_tick and tsc_ns_mult are initialized by
+   timer_calibrate(); until then, tsc_per_tick is 0 and
+   timer_ns() falls back to counting ticks. */
+static uint64_t tsc_boot;       /* TSC at timer_init(). */
+static uint64_t tsc_per_tick;   /* TSC cycles per timer tick. */
+static uint64_t tsc_ns_mult;    /* Nanoseconds per TSC cycle, times 2**32. */
+static uint64_t last_tick_tsc;  /* TSC at the latest timer tick. */
+
+/* Hierarchical timing wheel of threads put to sleep by
+   timer_sleep().  Level 0 has one slot per tick for the next
+   WHEEL_SIZE ticks; each slot of level N covers WHEEL_SIZE times
+   as many ticks as a slot of level N - 1.  Whenever the level-0
+   index wraps around, the current slot of the next level up is
+   "cascaded": its sleepers are redistributed into the finer
+   levels.  Each sleeper is thus moved at most WHEEL_LEVELS - 1
+   times, so inserting, removing and expiring a sleeper are all
+   O(1) amortized, however many threads are asleep. */
+#define WHEEL_BITS 6
+#define WHEEL_SIZE (1 << WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SIZE - 1)
+#define WHEEL_LEVELS 4
+#define WHEEL_SPAN ((int64_t) 1 << (WHEEL_BITS * WHEEL_LEVELS))
+static struct list wheel[WHEEL_LEVELS][WHEEL_SIZE];
+
+/* Last tick processed by the timing wheel. */
+static int64_t wheel_now;
+
+/* Tickless idle.
+
+   If timer_tickless is set, then whenever the idle thread is
+   about to halt, timer_idle_begin() stops the periodic tick and
+   arms the PIT as a one-shot timer for the next tick on which
+   the timing wheel has work to do, so the CPU is not woken up
+   for ticks that would do nothing.  The ticks that pass in the
+   meantime are caught up by the timer interrupt when the
+   one-shot fires.  If the CPU leaves the idle thread before
+   then, because another interrupt woke a thread, schedule()
+   calls timer_idle_end(), which counts them and brings the
+   periodic tick back.
+
+   A one-shot count is at most 65535 PIT cycles, so a single
+   one-shot covers at most ONESHOT_MAX_TICKS ticks; a longer
+   idle period takes several. */
+#define PIT_TICK ((PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ)
+#define ONESHOT_MAX_TICKS (UINT16_MAX / PIT_TICK)
+bool timer_tickless;
+
+/* Ticks spanned by the armed one-shot, or 0 if the PIT is in
+   periodic mode. */
+static int64_t oneshot_ticks;
+
+/* PIT count the one-shot was armed with, and the part of it
+   before the first tick it spans. */
+static unsigned oneshot_count;
+static unsigned oneshot_first;
+
+/* Ticks that passed while idle with the periodic tick stopped,
+   and that have been added to `ticks' but not yet reported to
+   the scheduler through thread_idle_tick(). */
+static int64_t ticks_owed;
+
+/* Number of timer interrupts taken. */
+static int64_t interrupt_cnt;
+
+/* Longest time spent in timer_interrupt(), in TSC cycles. */
+static uint64_t max_interrupt_cycles;
 
 static intr_handler_func timer_interrupt;
 static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
+static void tsc_calibrate (void);
+static int64_t tsc_to_ns (uint64_t tsc);
+static void sleep_until (int64_t wake_time);
 static void real_time_sleep (int64_t num, int32_t denom);
+static void tsc_sleep (int64_t num, int32_t denom);
 static void real_time_delay (int64_t num, int32_t denom);
 
-static bool timer_list_less_func(const struct list_elem *,
-                                 const struct list_elem *,
-                                 void *);
+static void wheel_insert (struct timer_sleep_list_elem *);
+static void wheel_cascade (int level);
+static int64_t wheel_idle_ticks (int64_t limit);
 static void wake_threads(void);
+static void oneshot_arm (int64_t tick_cnt, unsigned first);
+static uint64_t rdtsc (void);
 
 /* Sets up the timer to interrupt TIMER_FREQ times per second,
    and registers the corresponding interrupt. */
 void
 timer_init (void) 
 {
-  list_init (&timer_sleep_list);
+  int level, slot;
+
+  for (level = 0; level < WHEEL_LEVELS; level++)
+    for (slot = 0; slot < WHEEL_SIZE; slot++)
+      list_init (&wheel[level][slot]);
+  tsc_boot = last_tick_tsc = rdtsc ();
   pit_configure_channel (0, 2, TIMER_FREQ);
   intr_register_ext (0x20, timer_interrupt, "8254 Timer");
 }
 
-/* Calibrates loops_per_tick, used to implement brief delays. */
+/* Calibrates loops_per_tick, used to implement brief delays,
+   and the TSC clock against the timer. */
 void
 timer_calibrate (void) 
 {
@@ -72,7 +155,26 @@ timer_calibrate (void)
     if (!too_many_loops (high_bit | test_bit))
       loops_per_tick |= test_bit;
 
-  printf ("%'"PRIu64" loops/s.\n", (uint64_t) loops_per_tick * TIMER_FREQ);
+  printf ("%'"PRIu64" loops/s", (uint64_t) loops_per_tick * TIMER_FREQ);
+
+  tsc_calibrate ();
+  printf (", %'"PRIu64" TSC cycles/s.\n", tsc_per_tick * TIMER_FREQ);
+}
+
+/* Returns the CPU's time-stamp counter, which counts
+   timer_tsc_freq() cycles per second. */
+uint64_t
+timer_tsc (void) 
+{
+  return rdtsc ();
+}
+
+/* Returns the number of time-stamp counter cycles per second, as
+   measured by timer_calibrate(), or 0 before calibration. */
+uint64_t
+timer_tsc_freq (void) 
+{
+  return tsc_per_tick * TIMER_FREQ;
 }
 
 /* Returns the number of timer ticks since the OS booted. */
@@ -93,6 +195,19 @@ timer_elapsed (int64_t then)
   return timer_ticks () - then;
 }
 
+/* Returns the number of nanoseconds since the timer was
+   initialized, as measured by the CPU's time-stamp counter.
+   Unlike timer_ticks(), this does not turn off interrupts, and it
+   is precise to a CPU cycle rather than a timer tick.  Before
+   timer_calibrate() it is only precise to a timer tick. */
+int64_t
+timer_ns (void) 
+{
+  if (tsc_per_tick == 0)
+    return timer_ticks () * NS_PER_TICK;
+  return tsc_to_ns (rdtsc () - tsc_boot);
+}
+
 /* Sleeps for approximately TICKS timer ticks.  Interrupts must
    be turned on. */
 void
@@ -101,11 +216,16 @@ timer_sleep (int64_t ticks)
   if (ticks <= 0) {
     return;
   }
-  int64_t start = timer_ticks ();
-
   ASSERT (intr_get_level () == INTR_ON);
 
-  int64_t wake_time = start + ticks;
+  sleep_until (timer_ticks () + ticks);
+}
+
+/* Sleeps until timer tick WAKE_TIME.  Interrupts must be turned
+   on. */
+static void
+sleep_until (int64_t wake_time) 
+{
   struct semaphore semaphore;
   sema_init(&semaphore, 0);
 
@@ -113,8 +233,14 @@ timer_sleep (int64_t ticks)
   timer_elem.semaphore = &semaphore;
   timer_elem.wake_time = wake_time;
 
+  /* If a tick arrived since WAKE_TIME was computed, it may
+     already have been processed by the timing wheel. */
   enum intr_level old_level = intr_disable();
-  list_insert_ordered(&timer_sleep_list, &timer_elem.elem, &timer_list_less_func, NULL);
+  if (wake_time <= wheel_now) {
+    intr_set_level (old_level);
+    return;
+  }
+  wheel_insert (&timer_elem);
   intr_set_level (old_level);
 
   sema_down(&semaphore);
@@ -187,16 +313,142 @@ timer_ndelay (int64_t ns)
 void
 timer_print_stats (void) 
 {
-  printf ("Timer: %"PRId64" ticks\n", timer_ticks ());
+  printf ("Timer: %"PRId64" ticks, %"PRId64" interrupts, "
+          "longest interrupt %"PRIu64" cycles\n",
+          timer_ticks (), timer_interrupts (), timer_max_interrupt_cycles ());
+}
+
+/* Called by the idle thread, with interrupts off, just before it
+   halts the CPU.  In tickless mode, replaces the periodic tick
+   by a one-shot timer that fires at the next tick with work to
+   do. */
+void
+timer_idle_begin (void) 
+{
+  int64_t idle_ticks;
+  uint16_t left;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!timer_tickless || oneshot_ticks != 0 || ticks_owed != 0
+      || wheel_now != ticks)
+    return;
+
+  idle_ticks = wheel_idle_ticks (ONESHOT_MAX_TICKS);
+  if (idle_ticks <= 1)
+    return;
+
+  /* Keep the one-shot in step with the periodic tick: its first
+     tick is where the current period would have ended. */
+  left = pit_read_count (0, NULL);
+  if (left == 0 || left > PIT_TICK)
+    left = PIT_TICK;
+  oneshot_arm (idle_ticks, left);
+}
+
+/* Called by schedule(), with interrupts off, whenever the idle
+   thread gives up the CPU, which includes being switched away
+   from directly by an interrupt handler that woke a thread.  If
+   an interrupt other than the one-shot woke the CPU, accounts for
+   the ticks that have passed and arranges for the periodic tick
+   to resume at the next tick boundary. */
+void
+timer_idle_end (void) 
+{
+  unsigned elapsed, passed, left;
+  bool expired;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (oneshot_ticks == 0)
+    return;
+
+  /* If the count has run out, the timer interrupt is pending
+     and will do the work. */
+  elapsed = oneshot_count - pit_read_count (0, &expired);
+  if (expired)
+    return;
+
+  if (elapsed < oneshot_first) 
+    {
+      passed = 0;
+      left = oneshot_first - elapsed;
+    }
+  else 
+    {
+      passed = 1 + (elapsed - oneshot_first) / PIT_TICK;
+      left = PIT_TICK - (elapsed - oneshot_first) % PIT_TICK;
+    }
+  if (passed > 0)
+    last_tick_tsc = rdtsc () - (PIT_TICK - left) * tsc_per_tick / PIT_TICK;
+  ticks += passed;
+  ticks_owed += passed;
+  oneshot_arm (1, left);
+}
+
+/* Returns the number of timer interrupts taken since boot.  In
+   tickless mode this may be less than timer_ticks(). */
+int64_t
+timer_interrupts (void) 
+{
+  enum intr_level old_level = intr_disable ();
+  int64_t cnt = interrupt_cnt;
+  intr_set_level (old_level);
+  return cnt;
+}
+
+/* Returns the longest time spent in the timer interrupt handler
+   since boot or the last call to timer_reset_max_interrupt(), in
+   CPU time-stamp counter cycles. */
+uint64_t
+timer_max_interrupt_cycles (void) 
+{
+  enum intr_level old_level = intr_disable ();
+  uint64_t cycles = max_interrupt_cycles;
+  intr_set_level (old_level);
+  return cycles;
+}
+
+/* Forgets the longest time spent in the timer interrupt handler,
+   so that timer_max_interrupt_cycles() covers only the
+   interrupts from now on. */
+void
+timer_reset_max_interrupt (void) 
+{
+  enum intr_level old_level = intr_disable ();
+  max_interrupt_cycles = 0;
+  intr_set_level (old_level);
 }
 
 /* Timer interrupt handler. */
 static void
-timer_interrupt (struct intr_frame *args UNUSED)
+timer_interrupt (struct intr_frame *args)
 {
+  uint64_t start = rdtsc ();
+  uint64_t cycles;
+
+  last_tick_tsc = start;
+  interrupt_cnt++;
+  if (oneshot_ticks != 0) 
+    {
+      /* The one-shot ran out, so this is the last tick it
+         spans.  Count the others and go back to periodic ticks,
+         whose first period starts now. */
+      pit_configure_channel (0, 2, TIMER_FREQ);
+      ticks += oneshot_ticks - 1;
+      ticks_owed += oneshot_ticks - 1;
+      oneshot_ticks = 0;
+    }
+
   ticks++;
   wake_threads();
-  thread_tick ();
+  for (; ticks_owed > 0; ticks_owed--)
+    thread_idle_tick ();
+  thread_tick (args);
+
+  cycles = rdtsc () - start;
+  if (cycles > max_interrupt_cycles)
+    max_interrupt_cycles = cycles;
 }
 
 /* Returns true if LOOPS iterations waits for more than one timer
@@ -245,7 +497,13 @@ real_time_sleep (int64_t num, int32_t denom)
   int64_t ticks = num * TIMER_FREQ / denom;
 
   ASSERT (intr_get_level () == INTR_ON);
-  if (ticks > 0)
+  if (tsc_per_tick != 0)
+    {
+      /* The TSC clock is calibrated, so we can time the sleep
+         to a CPU cycle. */
+      tsc_sleep (num, denom);
+    }
+  else if (ticks > 0)
     {
       /* We're waiting for at least one full timer tick.  Use
          timer_sleep() because it will yield the CPU to other
@@ -260,6 +518,37 @@ real_time_sleep (int64_t num, int32_t denom)
     }
 }
 
+/* Sleeps for NUM/DENOM seconds, timed with the TSC.  Blocks
+   until the last timer tick before the deadline, yielding the
+   CPU to other processes, and then busy-waits only for the
+   remaining fraction of a tick. */
+static void
+tsc_sleep (int64_t num, int32_t denom) 
+{
+  int64_t ns, wake_time;
+  uint64_t deadline;
+  enum intr_level old_level;
+
+  ASSERT (1000000000 % denom == 0);
+  if (num <= 0)
+    return;
+  ns = num * (1000000000 / denom);
+
+  /* Timer ticks fall every tsc_per_tick cycles after the latest
+     one, so we can tell how many will pass before the deadline.
+     Interrupts are off so that `ticks' and `last_tick_tsc'
+     agree. */
+  old_level = intr_disable ();
+  deadline = (rdtsc () + ns / NS_PER_TICK * tsc_per_tick
+              + ns % NS_PER_TICK * tsc_per_tick / NS_PER_TICK);
+  wake_time = ticks + (deadline - last_tick_tsc) / tsc_per_tick;
+  intr_set_level (old_level);
+
+  sleep_until (wake_time);
+  while (rdtsc () < deadline)
+    barrier ();
+}
+
 /* Busy-wait for approximately NUM/DENOM seconds. */
 static void
 real_time_delay (int64_t num, int32_t denom)
@@ -270,26 +559,162 @@ real_time_delay (int64_t num, int32_t denom)
   busy_wait (loops_per_tick * num / 1000 * TIMER_FREQ / (denom / 1000)); 
 }
 
-/*The list_less_func for timer_sleep_list that compares the wake_time*/
-static bool timer_list_less_func(const struct list_elem *a,
-                                 const struct list_elem *b,
-                                 void *aux UNUSED) {
-  int64_t a_wake_time = list_entry(a, struct timer_sleep_list_elem, elem) -> wake_time;
-  int64_t b_wake_time = list_entry(b, struct timer_sleep_list_elem, elem) -> wake_time;
-  return a_wake_time < b_wake_time;
-}
-
-/*Traverses the timer_sleep_list to wake the necessary threads*/
-static void wake_threads(void) {
-  int64_t current_time = timer_ticks();
-  struct list_elem *e;
-  for (e = list_begin(&timer_sleep_list); e != list_end(&timer_sleep_list); e = list_next(e)) {
-    struct timer_sleep_list_elem *elem = list_entry(e, struct timer_sleep_list_elem, elem);
-    if (elem -> wake_time <= current_time) {
-      list_remove(&elem -> elem);
-      sema_up(elem -> semaphore);
-    } else {
+/* Adds sleeper E to the timing wheel.  A sleeper due within the
+   next WHEEL_SIZE ticks goes into level 0, in the slot for its
+   wake-up tick; one due later goes into the coarsest level whose
+   slots it falls within, to be cascaded downward as its wake-up
+   time approaches.  Sleepers further away than the whole wheel
+   spans are parked in the last slot the wheel can reach and
+   cascaded from there.  E must not be due before the tick being
+   processed.  Interrupts must be off. */
+static void
+wheel_insert (struct timer_sleep_list_elem *e) 
+{
+  int64_t when = e->wake_time;
+  int64_t delta = when - wheel_now;
+  int level;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (delta >= 0);
+
+  if (delta >= WHEEL_SPAN)
+    when = wheel_now + WHEEL_SPAN - 1;
+  delta = when - wheel_now;
+
+  for (level = 0; level < WHEEL_LEVELS - 1; level++)
+    if (delta < (int64_t) 1 << (WHEEL_BITS * (level + 1)))
       break;
+  list_push_back (&wheel[level][(when >> (WHEEL_BITS * level)) & WHEEL_MASK],
+                  &e->elem);
+}
+
+/* Returns the number of ticks, at most LIMIT, after which the
+   timing wheel next has a sleeper to wake or a slot to cascade.
+   Interrupts must be off. */
+static int64_t
+wheel_idle_ticks (int64_t limit) 
+{
+  int64_t n;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  for (n = 1; n < limit; n++) 
+    {
+      int64_t when = wheel_now + n;
+      if ((when & WHEEL_MASK) == 0
+          || !list_empty (&wheel[0][when & WHEEL_MASK]))
+        break;
     }
-  }
-}
\ No newline at end of file
+  return n;
+}
+
+/* Redistributes the sleepers in the current slot of LEVEL into
+   the finer levels.  Returns the index of that slot, so that the
+   caller can cascade the next level up as well when it is 0. */
+static int
+wheel_cascade_slot (int level) 
+{
+  int index = (wheel_now >> (WHEEL_BITS * level)) & WHEEL_MASK;
+  struct list *slot = &wheel[level][index];
+
+  while (!list_empty (slot))
+    wheel_insert (list_entry (list_pop_front (slot),
+                              struct timer_sleep_list_elem, elem));
+  return index;
+}
+
+/* Cascades the current slot of LEVEL, and of each level above it
+   whose index has wrapped around to 0 along with it. */
+static void
+wheel_cascade (int level) 
+{
+  for (; level < WHEEL_LEVELS; level++)
+    if (wheel_cascade_slot (level) != 0)
+      break;
+}
+
+/* Advances the timing wheel to the current tick and wakes up
+   every thread whose sleep has expired. */
+static void
+wake_threads (void) 
+{
+  int64_t now = timer_ticks ();
+
+  while (wheel_now < now) 
+    {
+      struct list *slot;
+
+      wheel_now++;
+      if ((wheel_now & WHEEL_MASK) == 0)
+        wheel_cascade (1);
+
+      slot = &wheel[0][wheel_now & WHEEL_MASK];
+      while (!list_empty (slot)) 
+        {
+          struct timer_sleep_list_elem *e
+            = list_entry (list_pop_front (slot),
+                          struct timer_sleep_list_elem, elem);
+          ASSERT (e->wake_time <= wheel_now);
+          sema_up (e->semaphore);
+        }
+    }
+}
+
+/* Arms channel 0 of the PIT as a one-shot timer spanning
+   TICK_CNT ticks, the first of which ends after FIRST PIT
+   cycles. */
+static void
+oneshot_arm (int64_t tick_cnt, unsigned first) 
+{
+  ASSERT (tick_cnt > 0 && tick_cnt <= ONESHOT_MAX_TICKS);
+  ASSERT (first > 0 && first <= PIT_TICK);
+
+  oneshot_ticks = tick_cnt;
+  oneshot_first = first;
+  oneshot_count = first + (tick_cnt - 1) * PIT_TICK;
+  pit_configure_oneshot (0, oneshot_count);
+}
+
+/* Measures tsc_per_tick by counting TSC cycles across
+   TSC_CALIBRATE_TICKS timer ticks, and derives tsc_ns_mult from
+   it. */
+static void
+tsc_calibrate (void) 
+{
+  int64_t start;
+  uint64_t tsc_start;
+
+  /* Wait for a timer tick. */
+  start = ticks;
+  while (ticks == start)
+    barrier ();
+
+  start = ticks;
+  tsc_start = rdtsc ();
+  while (ticks - start < TSC_CALIBRATE_TICKS)
+    barrier ();
+
+  tsc_per_tick = (rdtsc () - tsc_start) / TSC_CALIBRATE_TICKS;
+  ASSERT (tsc_per_tick != 0);
+  tsc_ns_mult = ((uint64_t) NS_PER_TICK << 32) / tsc_per_tick;
+}
+
+/* Converts TSC cycles into nanoseconds, without overflowing in
+   the intermediate products. */
+static int64_t
+tsc_to_ns (uint64_t tsc) 
+{
+  uint64_t hi = tsc >> 32, lo = tsc & 0xffffffff;
+  uint64_t mult_hi = tsc_ns_mult >> 32, mult_lo = tsc_ns_mult & 0xffffffff;
+
+  return hi * tsc_ns_mult + lo * mult_hi + ((lo * mult_lo) >> 32);
+}
+
+/* Returns the CPU's time-stamp counter. */
+static uint64_t
+rdtsc (void) 
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
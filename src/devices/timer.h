@@ -2,24 +2,32 @@
 #define DEVICES_TIMER_H
 
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include "../lib/kernel/list.h"
 
 /* Number of timer interrupts per second. */
 #define TIMER_FREQ 100
 
-/* List element for timer_sleep_list */
+/* A thread sleeping in timer_sleep(), as an element of the
+   timer's timing wheel. */
 struct timer_sleep_list_elem {
   struct semaphore *semaphore;
   int64_t wake_time;
   struct list_elem elem;
 };
 
+/* Stop the periodic tick while idle?  Set by -tickless. */
+extern bool timer_tickless;
+
 void timer_init (void);
 void timer_calibrate (void);
 
 int64_t timer_ticks (void);
 int64_t timer_elapsed (int64_t);
+int64_t timer_ns (void);
+uint64_t timer_tsc (void);
+uint64_t timer_tsc_freq (void);
 
 
 
@@ -29,11 +37,18 @@ void timer_msleep (int64_t milliseconds);
 void timer_usleep (int64_t microseconds);
 void timer_nsleep (int64_t nanoseconds);
 
+/* Tickless idle, called by the idle thread. */
+void timer_idle_begin (void);
+void timer_idle_end (void);
+
 /* Busy waits. */
 void timer_mdelay (int64_t milliseconds);
 void timer_udelay (int64_t microseconds);
 void timer_ndelay (int64_t nanoseconds);
 
 void timer_print_stats (void);
+int64_t timer_interrupts (void);
+uint64_t timer_max_interrupt_cycles (void);
+void timer_reset_max_interrupt (void);
 
 #endif /* devices/timer.h */
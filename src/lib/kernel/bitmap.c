@@ -28,6 +28,8 @@ struct bitmap
   {
     size_t bit_cnt;     /* Number of bits. */
     elem_type *bits;    /* Elements that represent bits. */
+    elem_type *full;    /* Optional summary: bit K is set if and only
+                           if all of the bits in bits[K] are set. */
   };
 
 /* Returns the index of the element that contains the bit
@@ -69,6 +71,88 @@ last_mask (const struct bitmap *b)
   return last_bits ? ((elem_type) 1 << last_bits) - 1 : (elem_type) -1;
 }
 
+/* Returns a mask of the bits in element IDX that represent bits
+   START through END - 1 of a bitmap.  The element must hold at
+   least one of those bits. */
+static inline elem_type
+range_mask (size_t idx, size_t start, size_t end) 
+{
+  size_t first = idx * ELEM_BITS;
+  elem_type mask = (elem_type) -1;
+
+  if (start > first)
+    mask &= (elem_type) -1 << (start - first);
+  if (end - first < ELEM_BITS)
+    mask &= ((elem_type) 1 << (end - first)) - 1;
+  return mask;
+}
+
+/* Returns the index of the lowest set bit in ELEM, which must
+   be nonzero.  This compiles to a single BSF instruction. */
+static inline int
+lowest_bit (elem_type elem) 
+{
+  ASSERT (elem != 0);
+  return __builtin_ctzl (elem);
+}
+
+/* Returns the number of set bits in ELEM. */
+static inline int
+count_bits (elem_type elem) 
+{
+  int cnt = 0;
+  for (; elem != 0; elem &= elem - 1)
+    cnt++;
+  return cnt;
+}
+
+/* Atomically sets the bits in MASK in *ELEM to true. */
+static inline void
+elem_mark (elem_type *elem, elem_type mask) 
+{
+  /* This is equivalent to `*elem |= mask' except that it
+     is guaranteed to be atomic on a uniprocessor machine.  See
+     the description of the OR instruction in [IA32-v2b]. */
+  asm ("orl %1, %0" : "=m" (*elem) : "r" (mask) : "cc");
+}
+
+/* Atomically sets the bits in MASK in *ELEM to false. */
+static inline void
+elem_reset (elem_type *elem, elem_type mask) 
+{
+  /* This is equivalent to `*elem &= ~mask' except that it
+     is guaranteed to be atomic on a uniprocessor machine.  See
+     the description of the AND instruction in [IA32-v2a]. */
+  asm ("andl %1, %0" : "=m" (*elem) : "r" (~mask) : "cc");
+}
+
+/* Brings the summary bit for element IDX of B up to date, if B
+   has a summary. */
+static inline void
+update_summary (struct bitmap *b, size_t idx) 
+{
+  if (b->full != NULL) 
+    {
+      elem_type full = (idx == elem_cnt (b->bit_cnt) - 1
+                        ? last_mask (b) : (elem_type) -1);
+      if (b->bits[idx] == full)
+        b->full[elem_idx (idx)] |= bit_mask (idx);
+      else
+        b->full[elem_idx (idx)] &= ~bit_mask (idx);
+    }
+}
+
+/* Recomputes every summary bit of B, if B has a summary. */
+static void
+rebuild_summary (struct bitmap *b) 
+{
+  size_t i;
+
+  if (b->full != NULL)
+    for (i = 0; i < elem_cnt (b->bit_cnt); i++)
+      update_summary (b, i);
+}
+
 /* Creation and destruction. */
 
 /* Initializes B to be a bitmap of BIT_CNT bits
@@ -83,6 +167,7 @@ bitmap_create (size_t bit_cnt)
     {
       b->bit_cnt = bit_cnt;
       b->bits = malloc (byte_cnt (bit_cnt));
+      b->full = NULL;
       if (b->bits != NULL || bit_cnt == 0)
         {
           bitmap_set_all (b, false);
@@ -105,6 +190,7 @@ bitmap_create_in_buf (size_t bit_cnt, void *block, size_t block_size UNUSED)
 
   b->bit_cnt = bit_cnt;
   b->bits = (elem_type *) (b + 1);
+  b->full = NULL;
   bitmap_set_all (b, false);
   return b;
 }
@@ -125,11 +211,38 @@ bitmap_destroy (struct bitmap *b)
 {
   if (b != NULL) 
     {
+      free (b->full);
       free (b->bits);
       free (b);
     }
 }
 
+/* Adds a summary to B, which must have been created by
+   bitmap_create(), that records which elements of B have all of
+   their bits set.  Scans for false bits use it to step over
+   ELEM_BITS fully set elements at a time, which pays off on a
+   large, mostly full bitmap.  Like the bits themselves, the
+   summary is updated atomically per element but not atomically
+   with the bits.
+   Returns true if successful, false if memory allocation
+   failed, in which case B keeps working without a summary. */
+bool
+bitmap_enable_summary (struct bitmap *b) 
+{
+  size_t summary_cnt = elem_cnt (elem_cnt (b->bit_cnt));
+
+  ASSERT (b != NULL);
+
+  if (b->full == NULL && summary_cnt > 0) 
+    {
+      b->full = calloc (summary_cnt, sizeof *b->full);
+      if (b->full == NULL)
+        return false;
+      rebuild_summary (b);
+    }
+  return true;
+}
+
 /* Bitmap size. */
 
 /* Returns the number of bits in B. */
@@ -158,12 +271,9 @@ void
 bitmap_mark (struct bitmap *b, size_t bit_idx) 
 {
   size_t idx = elem_idx (bit_idx);
-  elem_type mask = bit_mask (bit_idx);
 
-  /* This is equivalent to `b->bits[idx] |= mask' except that it
-     is guaranteed to be atomic on a uniprocessor machine.  See
-     the description of the OR instruction in [IA32-v2b]. */
-  asm ("orl %1, %0" : "=m" (b->bits[idx]) : "r" (mask) : "cc");
+  elem_mark (&b->bits[idx], bit_mask (bit_idx));
+  update_summary (b, idx);
 }
 
 /* Atomically sets the bit numbered BIT_IDX in B to false. */
@@ -171,12 +281,9 @@ void
 bitmap_reset (struct bitmap *b, size_t bit_idx) 
 {
   size_t idx = elem_idx (bit_idx);
-  elem_type mask = bit_mask (bit_idx);
 
-  /* This is equivalent to `b->bits[idx] &= ~mask' except that it
-     is guaranteed to be atomic on a uniprocessor machine.  See
-     the description of the AND instruction in [IA32-v2a]. */
-  asm ("andl %1, %0" : "=m" (b->bits[idx]) : "r" (~mask) : "cc");
+  elem_reset (&b->bits[idx], bit_mask (bit_idx));
+  update_summary (b, idx);
 }
 
 /* Atomically toggles the bit numbered IDX in B;
@@ -192,6 +299,7 @@ bitmap_flip (struct bitmap *b, size_t bit_idx)
      is guaranteed to be atomic on a uniprocessor machine.  See
      the description of the XOR instruction in [IA32-v2b]. */
   asm ("xorl %1, %0" : "=m" (b->bits[idx]) : "r" (mask) : "cc");
+  update_summary (b, idx);
 }
 
 /* Returns the value of the bit numbered IDX in B. */
@@ -214,7 +322,9 @@ bitmap_set_all (struct bitmap *b, bool value)
   bitmap_set_multiple (b, 0, bitmap_size (b), value);
 }
 
-/* Sets the CNT bits starting at START in B to VALUE. */
+/* Sets the CNT bits starting at START in B to VALUE.
+   Each element is updated atomically, but not the group as a
+   whole. */
 void
 bitmap_set_multiple (struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
@@ -224,8 +334,17 @@ bitmap_set_multiple (struct bitmap *b, size_t start, size_t cnt, bool value)
   ASSERT (start <= b->bit_cnt);
   ASSERT (start + cnt <= b->bit_cnt);
 
-  for (i = 0; i < cnt; i++)
-    bitmap_set (b, start + i, value);
+  if (cnt == 0)
+    return;
+  for (i = elem_idx (start); i <= elem_idx (start + cnt - 1); i++) 
+    {
+      elem_type mask = range_mask (i, start, start + cnt);
+      if (value)
+        elem_mark (&b->bits[i], mask);
+      else
+        elem_reset (&b->bits[i], mask);
+      update_summary (b, i);
+    }
 }
 
 /* Returns the number of bits in B between START and START + CNT,
@@ -239,11 +358,12 @@ bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool value)
   ASSERT (start <= b->bit_cnt);
   ASSERT (start + cnt <= b->bit_cnt);
 
+  if (cnt == 0)
+    return 0;
   value_cnt = 0;
-  for (i = 0; i < cnt; i++)
-    if (bitmap_test (b, start + i) == value)
-      value_cnt++;
-  return value_cnt;
+  for (i = elem_idx (start); i <= elem_idx (start + cnt - 1); i++)
+    value_cnt += count_bits (b->bits[i] & range_mask (i, start, start + cnt));
+  return value ? value_cnt : cnt - value_cnt;
 }
 
 /* Returns true if any bits in B between START and START + CNT,
@@ -257,9 +377,14 @@ bitmap_contains (const struct bitmap *b, size_t start, size_t cnt, bool value)
   ASSERT (start <= b->bit_cnt);
   ASSERT (start + cnt <= b->bit_cnt);
 
-  for (i = 0; i < cnt; i++)
-    if (bitmap_test (b, start + i) == value)
-      return true;
+  if (cnt == 0)
+    return false;
+  for (i = elem_idx (start); i <= elem_idx (start + cnt - 1); i++) 
+    {
+      elem_type elem = value ? b->bits[i] : ~b->bits[i];
+      if ((elem & range_mask (i, start, start + cnt)) != 0)
+        return true;
+    }
   return false;
 }
 
@@ -289,10 +414,63 @@ bitmap_all (const struct bitmap *b, size_t start, size_t cnt)
 
 /* Finding set or unset bits. */
 
+/* Returns the index of the first element of B at or after IDX
+   that does not have all of its bits set, according to B's
+   summary, or the number of elements in B if there is none. */
+static size_t
+next_nonfull_elem (const struct bitmap *b, size_t idx) 
+{
+  size_t cnt = elem_cnt (b->bit_cnt);
+  size_t summary_idx = elem_idx (idx);
+  elem_type summary;
+
+  if (idx >= cnt)
+    return cnt;
+  summary = ~b->full[summary_idx] & ((elem_type) -1 << (idx % ELEM_BITS));
+  while (summary == 0) 
+    {
+      if (++summary_idx >= elem_cnt (cnt))
+        return cnt;
+      summary = ~b->full[summary_idx];
+    }
+  idx = summary_idx * ELEM_BITS + lowest_bit (summary);
+  return idx < cnt ? idx : cnt;
+}
+
+/* Returns the index of the first bit in B at or after START and
+   before END that is set to VALUE, or END if there is none.
+   Examines a whole element at a time. */
+static size_t
+find_next (const struct bitmap *b, size_t start, size_t end, bool value) 
+{
+  elem_type flip = value ? 0 : (elem_type) -1;
+  size_t idx = elem_idx (start);
+  elem_type elem;
+
+  if (start >= end)
+    return end;
+  elem = (b->bits[idx] ^ flip) & ((elem_type) -1 << (start % ELEM_BITS));
+  while (elem == 0) 
+    {
+      idx++;
+      if (!value && b->full != NULL)
+        idx = next_nonfull_elem (b, idx);
+      if (idx * ELEM_BITS >= end)
+        return end;
+      elem = b->bits[idx] ^ flip;
+    }
+  start = idx * ELEM_BITS + lowest_bit (elem);
+  return start < end ? start : end;
+}
+
 /* Finds and returns the starting index of the first group of CNT
    consecutive bits in B at or after START that are all set to
    VALUE.
-   If there is no such group, returns BITMAP_ERROR. */
+   If there is no such group, returns BITMAP_ERROR.
+   Each candidate group starts at the next bit set to VALUE and
+   ends at the next bit after it that is not, both found an
+   element at a time, so a scan takes time linear in the number
+   of elements rather than in bits times CNT. */
 size_t
 bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
@@ -302,10 +480,22 @@ bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value)
   if (cnt <= b->bit_cnt) 
     {
       size_t last = b->bit_cnt - cnt;
-      size_t i;
-      for (i = start; i <= last; i++)
-        if (!bitmap_contains (b, i, cnt, !value))
-          return i; 
+      size_t i = start;
+
+      if (cnt == 0)
+        return start;
+      while (i <= last) 
+        {
+          size_t end;
+
+          i = find_next (b, i, last + 1, value);
+          if (i > last)
+            break;
+          end = find_next (b, i, i + cnt, !value);
+          if (end == i + cnt)
+            return i;
+          i = end;
+        }
     }
   return BITMAP_ERROR;
 }
@@ -347,6 +537,7 @@ bitmap_read (struct bitmap *b, struct file *file)
       off_t size = byte_cnt (b->bit_cnt);
       success = file_read_at (file, b->bits, size, 0) == size;
       b->bits[elem_cnt (b->bit_cnt) - 1] &= last_mask (b);
+      rebuild_summary (b);
     }
   return success;
 }
@@ -0,0 +1,195 @@
+#include "heap.h"
+#include "../debug.h"
+
+/* Each element keeps a pointer to its first child and its two
+   neighbors in its parent's list of children.  The first child
+   of a parent uses its `prev' pointer to point to the parent
+   instead, which lets any element be cut out of the tree in
+   constant time.  The root has no siblings and no parent. */
+
+static struct heap_elem *link (struct heap *,
+                               struct heap_elem *, struct heap_elem *);
+static struct heap_elem *merge_pairs (struct heap *, struct heap_elem *);
+static void cut (struct heap_elem *);
+
+/* Initializes HEAP as an empty heap ordered by LESS given
+   auxiliary data AUX. */
+void
+heap_init (struct heap *heap, heap_less_func *less, void *aux) 
+{
+  ASSERT (heap != NULL);
+  ASSERT (less != NULL);
+
+  heap->root = NULL;
+  heap->size = 0;
+  heap->less = less;
+  heap->aux = aux;
+}
+
+/* Returns the number of elements in HEAP. */
+size_t
+heap_size (const struct heap *heap) 
+{
+  return heap->size;
+}
+
+/* Returns true if HEAP is empty, false otherwise. */
+bool
+heap_empty (const struct heap *heap) 
+{
+  return heap->root == NULL;
+}
+
+/* Inserts ELEM into HEAP. */
+void
+heap_push (struct heap *heap, struct heap_elem *elem) 
+{
+  ASSERT (heap != NULL);
+  ASSERT (elem != NULL);
+
+  elem->child = elem->next = elem->prev = NULL;
+  heap->root = link (heap, heap->root, elem);
+  heap->size++;
+}
+
+/* Returns the maximum element in HEAP, which must not be
+   empty. */
+struct heap_elem *
+heap_top (const struct heap *heap) 
+{
+  ASSERT (!heap_empty (heap));
+  return heap->root;
+}
+
+/* Removes the maximum element from HEAP, which must not be
+   empty, and returns it. */
+struct heap_elem *
+heap_pop (struct heap *heap) 
+{
+  struct heap_elem *top = heap_top (heap);
+
+  heap->root = merge_pairs (heap, top->child);
+  heap->size--;
+  return top;
+}
+
+/* Removes ELEM, which must be in HEAP, from HEAP. */
+void
+heap_remove (struct heap *heap, struct heap_elem *elem) 
+{
+  ASSERT (!heap_empty (heap));
+
+  if (elem == heap->root)
+    heap_pop (heap);
+  else
+    {
+      cut (elem);
+      heap->root = link (heap, heap->root, merge_pairs (heap, elem->child));
+      heap->size--;
+    }
+}
+
+/* Restores the heap order after the key of ELEM, which must be
+   in HEAP, has increased or stayed the same. */
+void
+heap_increase (struct heap *heap, struct heap_elem *elem) 
+{
+  ASSERT (!heap_empty (heap));
+
+  if (elem != heap->root)
+    {
+      /* ELEM's subtree is still in heap order, so it can be
+         merged back in whole. */
+      cut (elem);
+      heap->root = link (heap, heap->root, elem);
+    }
+}
+
+/* Restores the heap order after the key of ELEM, which must be
+   in HEAP, has changed in either direction. */
+void
+heap_update (struct heap *heap, struct heap_elem *elem) 
+{
+  heap_remove (heap, elem);
+  heap_push (heap, elem);
+}
+
+/* Merges the trees rooted at A and B, either of which may be
+   null, and returns the root of the result.  A and B must not
+   have parents or siblings.  On ties A stays the root. */
+static struct heap_elem *
+link (struct heap *heap, struct heap_elem *a, struct heap_elem *b) 
+{
+  if (a == NULL)
+    return b;
+  if (b == NULL)
+    return a;
+  if (heap->less (a, b, heap->aux)) 
+    {
+      struct heap_elem *t = a;
+      a = b;
+      b = t;
+    }
+
+  /* Make B the first child of A. */
+  b->next = a->child;
+  if (b->next != NULL)
+    b->next->prev = b;
+  b->prev = a;
+  a->child = b;
+  return a;
+}
+
+/* Merges the list of sibling trees starting at FIRST into a
+   single tree and returns its root, using the standard
+   two-pass pairing: first merge siblings pairwise from left to
+   right, then merge the pairs from right to left. */
+static struct heap_elem *
+merge_pairs (struct heap *heap, struct heap_elem *first) 
+{
+  struct heap_elem *pairs = NULL;
+  struct heap_elem *root = NULL;
+
+  /* First pass.  The merged pairs are pushed onto PAIRS, which
+     leaves them in right-to-left order for the second pass. */
+  while (first != NULL) 
+    {
+      struct heap_elem *a = first;
+      struct heap_elem *b = a->next;
+
+      first = b != NULL ? b->next : NULL;
+      a->next = a->prev = NULL;
+      if (b != NULL)
+        b->next = b->prev = NULL;
+
+      a = link (heap, a, b);
+      a->next = pairs;
+      pairs = a;
+    }
+
+  /* Second pass. */
+  while (pairs != NULL) 
+    {
+      struct heap_elem *p = pairs;
+      pairs = p->next;
+      p->next = NULL;
+      root = link (heap, p, root);
+    }
+  return root;
+}
+
+/* Detaches the subtree rooted at ELEM, which must not be the
+   root of its heap, from its parent and siblings. */
+static void
+cut (struct heap_elem *elem) 
+{
+  ASSERT (elem->prev != NULL);
+
+  if (elem->prev->child == elem)
+    elem->prev->child = elem->next;
+  else
+    elem->prev->next = elem->next;
+  if (elem->next != NULL)
+    elem->next->prev = elem->prev;
+  elem->next = elem->prev = NULL;
+}
@@ -0,0 +1,78 @@
+#ifndef __LIB_KERNEL_HEAP_H
+#define __LIB_KERNEL_HEAP_H
+
+/* Priority queue (max-heap).
+
+   This is a pairing heap.  Insertion, merging an element whose
+   key has increased, and finding the maximum element are O(1).
+   Removing the maximum element or an arbitrary element is
+   O(log n) amortized.
+
+   Like the linked list and hash table, the heap does not use
+   dynamic allocation.  Instead, each structure that can
+   potentially be in a heap must embed a struct heap_elem
+   member.  All of the heap functions operate on these `struct
+   heap_elem's.  The heap_entry macro allows conversion from a
+   struct heap_elem back to a structure object that contains it.
+   Refer to lib/kernel/list.h for a detailed explanation of the
+   technique.
+
+   The heap orders its elements with a heap_less_func supplied
+   when it is initialized.  heap_top() returns an element that is
+   not less than any other.  If an element's key changes while it
+   is in a heap, the heap must be told, with heap_increase() or
+   heap_update(). */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Heap element. */
+struct heap_elem 
+  {
+    struct heap_elem *child;    /* First child. */
+    struct heap_elem *next;     /* Next sibling. */
+    struct heap_elem *prev;     /* Previous sibling, or parent. */
+  };
+
+/* Converts pointer to heap element HEAP_ELEM into a pointer to
+   the structure that HEAP_ELEM is embedded inside.  Supply the
+   name of the outer structure STRUCT and the member name MEMBER
+   of the heap element. */
+#define heap_entry(HEAP_ELEM, STRUCT, MEMBER)                   \
+        ((STRUCT *) ((uint8_t *) &(HEAP_ELEM)->next             \
+                     - offsetof (STRUCT, MEMBER.next)))
+
+/* Compares the value of two heap elements A and B, given
+   auxiliary data AUX.  Returns true if A is less than B, or
+   false if A is greater than or equal to B. */
+typedef bool heap_less_func (const struct heap_elem *a,
+                             const struct heap_elem *b,
+                             void *aux);
+
+/* Heap. */
+struct heap 
+  {
+    struct heap_elem *root;     /* Maximum element, or null. */
+    size_t size;                /* Number of elements. */
+    heap_less_func *less;       /* Comparison function. */
+    void *aux;                  /* Auxiliary data for `less'. */
+  };
+
+void heap_init (struct heap *, heap_less_func *, void *aux);
+
+/* Heap properties. */
+size_t heap_size (const struct heap *);
+bool heap_empty (const struct heap *);
+
+/* Basic operations. */
+void heap_push (struct heap *, struct heap_elem *);
+struct heap_elem *heap_top (const struct heap *);
+struct heap_elem *heap_pop (struct heap *);
+void heap_remove (struct heap *, struct heap_elem *);
+
+/* Key changes. */
+void heap_increase (struct heap *, struct heap_elem *);
+void heap_update (struct heap *, struct heap_elem *);
+
+#endif /* lib/kernel/heap.h */
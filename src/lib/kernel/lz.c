@@ -0,0 +1,191 @@
+#include "lz.h"
+#include <string.h>
+#include "../debug.h"
+
+/* Shortest match worth encoding. */
+#define MIN_MATCH 4
+
+/* Longest distance a match can reach back. */
+#define MAX_DISTANCE 65535
+
+/* Number of bits in a hash table index. */
+#define HASH_BITS 12
+
+static uint32_t read32 (const uint8_t *);
+static unsigned hash32 (uint32_t);
+static uint8_t *put_length (uint8_t *, size_t);
+static size_t length_bytes (size_t);
+
+/* Compresses the SIZE bytes at SRC into DST, which has room for
+   CAPACITY bytes, using the LZ_WORK_SIZE bytes at WORK as scratch
+   space.  Returns the size of the compressed data, or 0 if it
+   does not fit in CAPACITY bytes. */
+size_t
+lz_compress (const void *src_, size_t size,
+             void *dst_, size_t capacity, void *work) 
+{
+  const uint8_t *src = src_;
+  uint8_t *dst = dst_;
+  uint8_t *op = dst;
+  uint16_t *table = work;
+  size_t anchor = 0;
+  size_t ip = 0;
+  size_t lit;
+
+  ASSERT (size <= 65536);
+
+  /* Every entry starts out pointing at offset 0.  That is a
+     valid, if unlikely, candidate, since candidates are checked
+     before use. */
+  memset (table, 0, LZ_WORK_SIZE);
+
+  while (ip + MIN_MATCH <= size) 
+    {
+      uint32_t x = read32 (src + ip);
+      unsigned h = hash32 (x);
+      size_t ref = table[h];
+      size_t len;
+      uint8_t *token;
+
+      table[h] = ip;
+      if (ref >= ip || ip - ref > MAX_DISTANCE || read32 (src + ref) != x)
+        {
+          ip++;
+          continue;
+        }
+
+      len = MIN_MATCH;
+      while (ip + len < size && src[ref + len] == src[ip + len])
+        len++;
+
+      /* Token, literals, distance and match length. */
+      lit = ip - anchor;
+      if ((size_t) (op - dst) + 1 + length_bytes (lit) + lit + 2
+          + length_bytes (len - MIN_MATCH) > capacity)
+        return 0;
+      token = op++;
+      *token = (lit < 15 ? lit : 15) << 4;
+      op = put_length (op, lit);
+      memcpy (op, src + anchor, lit);
+      op += lit;
+      *op++ = (ip - ref) & 0xff;
+      *op++ = (ip - ref) >> 8;
+      *token |= len - MIN_MATCH < 15 ? len - MIN_MATCH : 15;
+      op = put_length (op, len - MIN_MATCH);
+
+      ip += len;
+      anchor = ip;
+    }
+
+  /* The rest goes out as literals. */
+  lit = size - anchor;
+  if ((size_t) (op - dst) + 1 + length_bytes (lit) + lit > capacity)
+    return 0;
+  *op++ = (lit < 15 ? lit : 15) << 4;
+  op = put_length (op, lit);
+  memcpy (op, src + anchor, lit);
+  op += lit;
+  return op - dst;
+}
+
+/* Decompresses the SIZE bytes of compressed data at SRC into DST,
+   which has room for CAPACITY bytes.  Returns the size of the
+   decompressed data, or SIZE_MAX if SRC is not valid compressed
+   data or does not fit in CAPACITY bytes. */
+size_t
+lz_decompress (const void *src_, size_t size, void *dst_, size_t capacity) 
+{
+  const uint8_t *ip = src_;
+  const uint8_t *end = ip + size;
+  uint8_t *dst = dst_;
+  uint8_t *op = dst;
+
+  while (ip < end) 
+    {
+      unsigned token = *ip++;
+      size_t lit = token >> 4;
+      size_t len = token & 15;
+      size_t distance;
+      uint8_t b;
+
+      if (lit == 15)
+        do
+          {
+            if (ip >= end)
+              return SIZE_MAX;
+            b = *ip++;
+            lit += b;
+          }
+        while (b == 255);
+      if (lit > (size_t) (end - ip) || lit > capacity - (op - dst))
+        return SIZE_MAX;
+      memcpy (op, ip, lit);
+      ip += lit;
+      op += lit;
+
+      /* Only the last sequence ends here. */
+      if (ip == end)
+        return op - dst;
+
+      if (end - ip < 2)
+        return SIZE_MAX;
+      distance = ip[0] | (ip[1] << 8);
+      ip += 2;
+      if (len == 15)
+        do
+          {
+            if (ip >= end)
+              return SIZE_MAX;
+            b = *ip++;
+            len += b;
+          }
+        while (b == 255);
+      len += MIN_MATCH;
+      if (distance == 0 || distance > (size_t) (op - dst)
+          || len > capacity - (op - dst))
+        return SIZE_MAX;
+
+      /* Byte by byte, since a match may overlap its own output. */
+      for (; len > 0; len--, op++)
+        *op = op[-distance];
+    }
+  return SIZE_MAX;
+}
+
+/* Returns the 4 bytes at P as an integer. */
+static uint32_t
+read32 (const uint8_t *p) 
+{
+  uint32_t x;
+  memcpy (&x, p, sizeof x);
+  return x;
+}
+
+/* Returns a hash table index for the 4 bytes X. */
+static unsigned
+hash32 (uint32_t x) 
+{
+  return (x * 2654435761u) >> (32 - HASH_BITS);
+}
+
+/* Writes the extra length bytes for length LEN, whose nibble in
+   the token is 15 if it does not fit, at OP.  Returns the end of
+   what was written. */
+static uint8_t *
+put_length (uint8_t *op, size_t len) 
+{
+  if (len >= 15)
+    {
+      for (len -= 15; len >= 255; len -= 255)
+        *op++ = 255;
+      *op++ = len;
+    }
+  return op;
+}
+
+/* Returns the number of bytes put_length() writes for LEN. */
+static size_t
+length_bytes (size_t len) 
+{
+  return len >= 15 ? (len - 15) / 255 + 1 : 0;
+}
@@ -0,0 +1,33 @@
+#ifndef __LIB_KERNEL_LZ_H
+#define __LIB_KERNEL_LZ_H
+
+/* Fast LZ77 compression of small buffers.
+
+   The format follows LZ4's block format: a series of sequences,
+   each a token byte, a run of literal bytes copied as is, and a
+   match that repeats bytes already produced.  The high nibble of
+   the token is the literal length and the low nibble the match
+   length less 4; a nibble of 15 is followed by further length
+   bytes, each added in until one is less than 255.  A match is
+   given as a 2-byte little-endian distance back into the output.
+   The last sequence has literals only.
+
+   The compressor finds matches through a small hash table of
+   recent 4-byte strings rather than searching exhaustively, so
+   it is fast but does not find the best parse.  Inputs are
+   limited to 64 kB. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Bytes of scratch space lz_compress() needs: a hash table of
+   2**HASH_BITS offsets (see lz.c). */
+#define LZ_WORK_SIZE (4096 * sizeof (uint16_t))
+
+size_t lz_compress (const void *src, size_t size,
+                    void *dst, size_t capacity, void *work);
+size_t lz_decompress (const void *src, size_t size,
+                      void *dst, size_t capacity);
+
+#endif /* lib/kernel/lz.h */
@@ -0,0 +1,447 @@
+#include "rbtree.h"
+#include "../debug.h"
+
+/* Every path from the root down to a null child passes through
+   the same number of black nodes, and no red node has a red
+   child.  Together these keep the longest path within twice
+   the shortest, so the height is O(log n).  Null children count
+   as black. */
+
+static void set_child (struct rb_tree *, struct rb_elem *parent,
+                       struct rb_elem *old, struct rb_elem *new);
+static void rotate_left (struct rb_tree *, struct rb_elem *);
+static void rotate_right (struct rb_tree *, struct rb_elem *);
+static void insert_fixup (struct rb_tree *, struct rb_elem *);
+static void remove_fixup (struct rb_tree *, struct rb_elem *,
+                          struct rb_elem *parent);
+static bool is_red (const struct rb_elem *);
+
+/* Initializes TREE as an empty tree ordered by LESS given
+   auxiliary data AUX. */
+void
+rb_init (struct rb_tree *tree, rb_less_func *less, void *aux) 
+{
+  ASSERT (tree != NULL);
+  ASSERT (less != NULL);
+
+  tree->root = NULL;
+  tree->size = 0;
+  tree->less = less;
+  tree->aux = aux;
+}
+
+/* Removes all the elements from TREE.  If ACTION is non-null,
+   it is called for each element after the element is removed,
+   and may free the memory used by the element. */
+void
+rb_clear (struct rb_tree *tree, rb_action_func *action) 
+{
+  struct rb_elem *e = tree->root;
+
+  /* Free children before their parents, without recursion, by
+     detaching each leaf from its parent as it is reached. */
+  while (e != NULL) 
+    {
+      if (e->left != NULL)
+        e = e->left;
+      else if (e->right != NULL)
+        e = e->right;
+      else 
+        {
+          struct rb_elem *parent = e->parent;
+
+          if (parent != NULL)
+            {
+              if (parent->left == e)
+                parent->left = NULL;
+              else
+                parent->right = NULL;
+            }
+          if (action != NULL)
+            action (e, tree->aux);
+          e = parent;
+        }
+    }
+
+  tree->root = NULL;
+  tree->size = 0;
+}
+
+/* Returns the number of elements in TREE. */
+size_t
+rb_size (const struct rb_tree *tree) 
+{
+  return tree->size;
+}
+
+/* Returns true if TREE is empty, false otherwise. */
+bool
+rb_empty (const struct rb_tree *tree) 
+{
+  return tree->root == NULL;
+}
+
+/* Inserts ELEM into TREE, if no equal element is already
+   present, and returns a null pointer.  If an equal element is
+   already in TREE, returns it without inserting ELEM. */
+struct rb_elem *
+rb_insert (struct rb_tree *tree, struct rb_elem *elem) 
+{
+  struct rb_elem *parent = NULL;
+  struct rb_elem **link = &tree->root;
+
+  ASSERT (elem != NULL);
+
+  while (*link != NULL) 
+    {
+      parent = *link;
+      if (tree->less (elem, parent, tree->aux))
+        link = &parent->left;
+      else if (tree->less (parent, elem, tree->aux))
+        link = &parent->right;
+      else
+        return parent;
+    }
+
+  elem->parent = parent;
+  elem->left = elem->right = NULL;
+  elem->red = true;
+  *link = elem;
+  insert_fixup (tree, elem);
+  tree->size++;
+  return NULL;
+}
+
+/* Removes ELEM, which must be in TREE, from TREE. */
+void
+rb_remove (struct rb_tree *tree, struct rb_elem *elem) 
+{
+  struct rb_elem *child, *parent;
+  bool removed_red;
+
+  ASSERT (!rb_empty (tree));
+
+  if (elem->left == NULL || elem->right == NULL) 
+    {
+      /* ELEM has at most one child, which takes its place. */
+      child = elem->left != NULL ? elem->left : elem->right;
+      parent = elem->parent;
+      removed_red = elem->red;
+      if (child != NULL)
+        child->parent = parent;
+      set_child (tree, parent, elem, child);
+    }
+  else 
+    {
+      /* ELEM's successor, which has no left child, leaves its own
+         spot and takes ELEM's place and color. */
+      struct rb_elem *next = elem->right;
+      while (next->left != NULL)
+        next = next->left;
+
+      removed_red = next->red;
+      child = next->right;
+      if (next->parent == elem)
+        parent = next;
+      else 
+        {
+          parent = next->parent;
+          parent->left = child;
+          if (child != NULL)
+            child->parent = parent;
+          next->right = elem->right;
+          next->right->parent = next;
+        }
+      next->left = elem->left;
+      next->left->parent = next;
+      next->parent = elem->parent;
+      set_child (tree, elem->parent, elem, next);
+      next->red = elem->red;
+    }
+
+  if (!removed_red)
+    remove_fixup (tree, child, parent);
+  tree->size--;
+}
+
+/* Returns an element of TREE equal to KEY, or a null pointer if
+   there is none. */
+struct rb_elem *
+rb_find (const struct rb_tree *tree, const struct rb_elem *key) 
+{
+  struct rb_elem *e = tree->root;
+
+  while (e != NULL) 
+    {
+      if (tree->less (key, e, tree->aux))
+        e = e->left;
+      else if (tree->less (e, key, tree->aux))
+        e = e->right;
+      else
+        return e;
+    }
+  return NULL;
+}
+
+/* Returns the first element of TREE, in order, that is not less
+   than KEY, or a null pointer if every element is less. */
+struct rb_elem *
+rb_lower_bound (const struct rb_tree *tree, const struct rb_elem *key) 
+{
+  struct rb_elem *e = tree->root;
+  struct rb_elem *bound = NULL;
+
+  while (e != NULL) 
+    {
+      if (tree->less (e, key, tree->aux))
+        e = e->right;
+      else 
+        {
+          bound = e;
+          e = e->left;
+        }
+    }
+  return bound;
+}
+
+/* Returns the least element of TREE, or a null pointer if TREE
+   is empty. */
+struct rb_elem *
+rb_first (const struct rb_tree *tree) 
+{
+  struct rb_elem *e = tree->root;
+
+  if (e != NULL)
+    while (e->left != NULL)
+      e = e->left;
+  return e;
+}
+
+/* Returns the greatest element of TREE, or a null pointer if
+   TREE is empty. */
+struct rb_elem *
+rb_last (const struct rb_tree *tree) 
+{
+  struct rb_elem *e = tree->root;
+
+  if (e != NULL)
+    while (e->right != NULL)
+      e = e->right;
+  return e;
+}
+
+/* Returns the element that follows ELEM in its tree, or a null
+   pointer if ELEM is the greatest. */
+struct rb_elem *
+rb_next (struct rb_elem *elem) 
+{
+  if (elem->right != NULL)
+    {
+      elem = elem->right;
+      while (elem->left != NULL)
+        elem = elem->left;
+      return elem;
+    }
+  while (elem->parent != NULL && elem->parent->right == elem)
+    elem = elem->parent;
+  return elem->parent;
+}
+
+/* Returns the element that precedes ELEM in its tree, or a null
+   pointer if ELEM is the least. */
+struct rb_elem *
+rb_prev (struct rb_elem *elem) 
+{
+  if (elem->left != NULL)
+    {
+      elem = elem->left;
+      while (elem->right != NULL)
+        elem = elem->right;
+      return elem;
+    }
+  while (elem->parent != NULL && elem->parent->left == elem)
+    elem = elem->parent;
+  return elem->parent;
+}
+
+/* Returns true if E is a red node.  Null children are black. */
+static bool
+is_red (const struct rb_elem *e) 
+{
+  return e != NULL && e->red;
+}
+
+/* Makes NEW the child of PARENT in place of OLD, or the root of
+   TREE if PARENT is null. */
+static void
+set_child (struct rb_tree *tree, struct rb_elem *parent,
+           struct rb_elem *old, struct rb_elem *new) 
+{
+  if (parent == NULL)
+    tree->root = new;
+  else if (parent->left == old)
+    parent->left = new;
+  else
+    parent->right = new;
+}
+
+/* Rotates the subtree rooted at E to the left, making E's right
+   child its parent. */
+static void
+rotate_left (struct rb_tree *tree, struct rb_elem *e) 
+{
+  struct rb_elem *r = e->right;
+
+  e->right = r->left;
+  if (e->right != NULL)
+    e->right->parent = e;
+  r->parent = e->parent;
+  set_child (tree, e->parent, e, r);
+  r->left = e;
+  e->parent = r;
+}
+
+/* Rotates the subtree rooted at E to the right, making E's left
+   child its parent. */
+static void
+rotate_right (struct rb_tree *tree, struct rb_elem *e) 
+{
+  struct rb_elem *l = e->left;
+
+  e->left = l->right;
+  if (e->left != NULL)
+    e->left->parent = e;
+  l->parent = e->parent;
+  set_child (tree, e->parent, e, l);
+  l->right = e;
+  e->parent = l;
+}
+
+/* Restores the red-black properties after red node E has been
+   added as a leaf. */
+static void
+insert_fixup (struct rb_tree *tree, struct rb_elem *e) 
+{
+  struct rb_elem *parent;
+
+  while (is_red (parent = e->parent)) 
+    {
+      /* A red parent is never the root, so E has a grandparent. */
+      struct rb_elem *grand = parent->parent;
+
+      if (parent == grand->left) 
+        {
+          struct rb_elem *uncle = grand->right;
+          if (is_red (uncle))
+            {
+              parent->red = uncle->red = false;
+              grand->red = true;
+              e = grand;
+              continue;
+            }
+          if (e == parent->right)
+            {
+              rotate_left (tree, parent);
+              e = parent;
+              parent = e->parent;
+            }
+          parent->red = false;
+          grand->red = true;
+          rotate_right (tree, grand);
+        }
+      else 
+        {
+          struct rb_elem *uncle = grand->left;
+          if (is_red (uncle))
+            {
+              parent->red = uncle->red = false;
+              grand->red = true;
+              e = grand;
+              continue;
+            }
+          if (e == parent->left)
+            {
+              rotate_right (tree, parent);
+              e = parent;
+              parent = e->parent;
+            }
+          parent->red = false;
+          grand->red = true;
+          rotate_left (tree, grand);
+        }
+    }
+  tree->root->red = false;
+}
+
+/* Restores the red-black properties after a black node was
+   removed from above E, a child of PARENT.  E may be null, which
+   is why PARENT is passed separately. */
+static void
+remove_fixup (struct rb_tree *tree, struct rb_elem *e,
+              struct rb_elem *parent) 
+{
+  while (e != tree->root && !is_red (e)) 
+    {
+      if (e == parent->left) 
+        {
+          struct rb_elem *sib = parent->right;
+          if (sib->red)
+            {
+              sib->red = false;
+              parent->red = true;
+              rotate_left (tree, parent);
+              sib = parent->right;
+            }
+          if (!is_red (sib->left) && !is_red (sib->right))
+            {
+              sib->red = true;
+              e = parent;
+              parent = e->parent;
+              continue;
+            }
+          if (!is_red (sib->right))
+            {
+              sib->left->red = false;
+              sib->red = true;
+              rotate_right (tree, sib);
+              sib = parent->right;
+            }
+          sib->red = parent->red;
+          parent->red = false;
+          sib->right->red = false;
+          rotate_left (tree, parent);
+        }
+      else 
+        {
+          struct rb_elem *sib = parent->left;
+          if (sib->red)
+            {
+              sib->red = false;
+              parent->red = true;
+              rotate_right (tree, parent);
+              sib = parent->left;
+            }
+          if (!is_red (sib->left) && !is_red (sib->right))
+            {
+              sib->red = true;
+              e = parent;
+              parent = e->parent;
+              continue;
+            }
+          if (!is_red (sib->left))
+            {
+              sib->right->red = false;
+              sib->red = true;
+              rotate_left (tree, sib);
+              sib = parent->left;
+            }
+          sib->red = parent->red;
+          parent->red = false;
+          sib->left->red = false;
+          rotate_right (tree, parent);
+        }
+      e = tree->root;
+    }
+  if (e != NULL)
+    e->red = false;
+}
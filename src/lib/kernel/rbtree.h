@@ -0,0 +1,88 @@
+#ifndef __LIB_KERNEL_RBTREE_H
+#define __LIB_KERNEL_RBTREE_H
+
+/* Ordered set (red-black tree).
+
+   Insertion, removal and lookup are O(log n) in the worst case.
+   Elements can be visited in order with rb_first() and
+   rb_next(), or in reverse with rb_last() and rb_prev().
+
+   Like the linked list and hash table, the tree does not use
+   dynamic allocation.  Instead, each structure that can
+   potentially be in a tree must embed a struct rb_elem member.
+   All of the tree functions operate on these `struct rb_elem's.
+   The rb_entry macro allows conversion from a struct rb_elem
+   back to a structure object that contains it.  Refer to
+   lib/kernel/list.h for a detailed explanation of the
+   technique.
+
+   The tree orders its elements with an rb_less_func supplied
+   when it is initialized.  Two elements are equal if neither is
+   less than the other, and a tree never holds two equal
+   elements.  The comparison need not be a total order on
+   values: for example, a tree of disjoint ranges that calls two
+   ranges equal when they overlap can find the range holding an
+   address with rb_find(). */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Tree element. */
+struct rb_elem 
+  {
+    struct rb_elem *parent;     /* Parent, or null for the root. */
+    struct rb_elem *left;       /* Left child, or null. */
+    struct rb_elem *right;      /* Right child, or null. */
+    bool red;                   /* Red or black node? */
+  };
+
+/* Converts pointer to tree element RB_ELEM into a pointer to
+   the structure that RB_ELEM is embedded inside.  Supply the
+   name of the outer structure STRUCT and the member name MEMBER
+   of the tree element. */
+#define rb_entry(RB_ELEM, STRUCT, MEMBER)                       \
+        ((STRUCT *) ((uint8_t *) &(RB_ELEM)->left               \
+                     - offsetof (STRUCT, MEMBER.left)))
+
+/* Compares the value of two tree elements A and B, given
+   auxiliary data AUX.  Returns true if A is less than B, or
+   false if A is greater than or equal to B. */
+typedef bool rb_less_func (const struct rb_elem *a,
+                           const struct rb_elem *b,
+                           void *aux);
+
+/* Performs some operation on tree element E, given auxiliary
+   data AUX. */
+typedef void rb_action_func (struct rb_elem *e, void *aux);
+
+/* Red-black tree. */
+struct rb_tree 
+  {
+    struct rb_elem *root;       /* Root, or null if empty. */
+    size_t size;                /* Number of elements. */
+    rb_less_func *less;         /* Comparison function. */
+    void *aux;                  /* Auxiliary data for `less'. */
+  };
+
+void rb_init (struct rb_tree *, rb_less_func *, void *aux);
+void rb_clear (struct rb_tree *, rb_action_func *);
+
+/* Tree properties. */
+size_t rb_size (const struct rb_tree *);
+bool rb_empty (const struct rb_tree *);
+
+/* Basic operations. */
+struct rb_elem *rb_insert (struct rb_tree *, struct rb_elem *);
+void rb_remove (struct rb_tree *, struct rb_elem *);
+struct rb_elem *rb_find (const struct rb_tree *, const struct rb_elem *);
+struct rb_elem *rb_lower_bound (const struct rb_tree *,
+                                const struct rb_elem *);
+
+/* Traversal. */
+struct rb_elem *rb_first (const struct rb_tree *);
+struct rb_elem *rb_last (const struct rb_tree *);
+struct rb_elem *rb_next (struct rb_elem *);
+struct rb_elem *rb_prev (struct rb_elem *);
+
+#endif /* lib/kernel/rbtree.h */
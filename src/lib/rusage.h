@@ -0,0 +1,24 @@
+#ifndef __LIB_RUSAGE_H
+#define __LIB_RUSAGE_H
+
+#include <stdint.h>
+
+/* Resource usage of a thread, or of the children it has waited
+   for.  Shared by the kernel and user programs, which obtain it
+   through the getrusage system call. */
+struct rusage 
+  {
+    int64_t user_ticks;         /* Timer ticks spent in user mode. */
+    int64_t kernel_ticks;       /* Timer ticks spent in kernel mode. */
+    uint32_t voluntary_switches; /* Gave up the CPU to block or yield. */
+    uint32_t involuntary_switches; /* Preempted by another thread. */
+    uint32_t page_faults;       /* Page faults taken. */
+    uint64_t bytes_read;        /* Bytes read by the read system call. */
+    uint64_t bytes_written;     /* Bytes written by the write system call. */
+  };
+
+/* Values for the WHO argument to getrusage(). */
+#define RUSAGE_SELF 0           /* The calling process. */
+#define RUSAGE_CHILDREN (-1)    /* Children that have been waited for. */
+
+#endif /* lib/rusage.h */
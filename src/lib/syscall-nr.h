@@ -28,7 +28,22 @@ enum
     SYS_MKDIR,                  /* Create a directory. */
     SYS_READDIR,                /* Reads a directory entry. */
     SYS_ISDIR,                  /* Tests if a fd represents a directory. */
-    SYS_INUMBER                 /* Returns the inode number for a fd. */
+    SYS_INUMBER,                /* Returns the inode number for a fd. */
+
+    /* Scheduler statistics. */
+    SYS_GET_NICE,               /* Obtain this process's nice value. */
+    SYS_SET_NICE,               /* Change this process's nice value. */
+    SYS_GET_LOAD_AVG,           /* Obtain 100 times the load average. */
+    SYS_GET_RECENT_CPU,         /* Obtain 100 times this process's recent_cpu. */
+
+    /* Clocks. */
+    SYS_TIME_NS,                /* Obtain nanoseconds since boot. */
+
+    /* Resource usage. */
+    SYS_GETRUSAGE,              /* Obtain a process's resource usage. */
+
+    /* Process duplication. */
+    SYS_FORK                    /* Copy this process. */
   };
 
 #endif /* lib/syscall-nr.h */
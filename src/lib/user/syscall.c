@@ -182,3 +182,53 @@ inumber (int fd)
 {
   return syscall1 (SYS_INUMBER, fd);
 }
+
+int
+get_nice (void)
+{
+  return syscall0 (SYS_GET_NICE);
+}
+
+void
+set_nice (int nice)
+{
+  syscall1 (SYS_SET_NICE, nice);
+}
+
+int
+get_load_avg (void)
+{
+  return syscall0 (SYS_GET_LOAD_AVG);
+}
+
+int
+get_recent_cpu (void)
+{
+  return syscall0 (SYS_GET_RECENT_CPU);
+}
+
+int64_t
+time_ns (void)
+{
+  int64_t ns;
+
+  /* The 64-bit result comes back in EDX:EAX. */
+  asm volatile
+    ("pushl %[number]; int $0x30; addl $4, %%esp"
+       : "=A" (ns)
+       : [number] "i" (SYS_TIME_NS)
+       : "memory");
+  return ns;
+}
+
+int
+getrusage (int who, struct rusage *usage)
+{
+  return syscall2 (SYS_GETRUSAGE, who, usage);
+}
+
+pid_t
+fork (void)
+{
+  return (pid_t) syscall0 (SYS_FORK);
+}
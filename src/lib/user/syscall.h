@@ -2,7 +2,9 @@
 #define __LIB_USER_SYSCALL_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <debug.h>
+#include <rusage.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -45,4 +47,19 @@ bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
 
+/* Scheduler statistics. */
+int get_nice (void);
+void set_nice (int nice);
+int get_load_avg (void);
+int get_recent_cpu (void);
+
+/* Clocks. */
+int64_t time_ns (void);
+
+/* Resource usage. */
+int getrusage (int who, struct rusage *);
+
+/* Process duplication. */
+pid_t fork (void);
+
 #endif /* lib/user/syscall.h */
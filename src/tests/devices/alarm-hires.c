@@ -0,0 +1,38 @@
+/* Sleeps for durations that are not whole numbers of timer
+   ticks and checks, against the nanosecond clock, that each
+   sleep lasts at least as long as asked but not a whole tick
+   longer. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/devices/tests.h"
+#include "threads/init.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+void
+test_alarm_hires (void) 
+{
+  static const int64_t sleeps_us[] = {250, 2500, 12345, 31416};
+  const int sleep_cnt = sizeof sleeps_us / sizeof *sleeps_us;
+  const int64_t tick_ns = 1000000000 / TIMER_FREQ;
+  int i;
+
+  for (i = 0; i < sleep_cnt; i++) 
+    {
+      int64_t want = sleeps_us[i] * 1000;
+      int64_t start = timer_ns ();
+      int64_t got;
+
+      timer_usleep (sleeps_us[i]);
+      got = timer_ns () - start;
+
+      msg ("asked for %"PRId64" us, slept %"PRId64" us",
+           sleeps_us[i], got / 1000);
+      if (got < want)
+        fail ("woke up %"PRId64" ns early", want - got);
+      if (got >= want + tick_ns)
+        fail ("woke up %"PRId64" ns late", got - want);
+    }
+  pass ();
+}
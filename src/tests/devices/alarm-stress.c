@@ -0,0 +1,81 @@
+/* Puts many threads to sleep at once for scattered durations,
+   some long enough to be cascaded down the timer's timing wheel,
+   and checks that each one wakes up on time.  Reports the
+   longest time spent in the timer interrupt handler while they
+   sleep, which should stay small no matter how many threads are
+   asleep. */
+
+#include <inttypes.h>
+#include <random.h>
+#include <stdio.h>
+#include "tests/devices/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Number of sleeping threads. */
+#define SLEEPER_CNT 256
+
+/* Longest sleep, in ticks.  Longer than two turns of the finest
+   level of the timing wheel. */
+#define MAX_SLEEP 300
+
+struct sleeper 
+  {
+    int64_t duration;           /* Ticks to sleep. */
+    int64_t lateness;           /* Ticks late waking up, or -1 if early. */
+  };
+
+static thread_func sleeper_thread;
+static struct semaphore done;
+
+void
+test_alarm_stress (void) 
+{
+  static struct sleeper sleepers[SLEEPER_CNT];
+  int64_t max_lateness = 0;
+  int i;
+
+  sema_init (&done, 0);
+  random_init (0);
+  timer_reset_max_interrupt ();
+
+  for (i = 0; i < SLEEPER_CNT; i++) 
+    {
+      struct sleeper *s = &sleepers[i];
+      s->duration = random_ulong () % MAX_SLEEP + 1;
+      thread_create ("sleeper", PRI_DEFAULT, sleeper_thread, s);
+    }
+  for (i = 0; i < SLEEPER_CNT; i++)
+    sema_down (&done);
+
+  for (i = 0; i < SLEEPER_CNT; i++) 
+    {
+      if (sleepers[i].lateness < 0)
+        fail ("sleeper %d woke up early", i);
+      if (sleepers[i].lateness > max_lateness)
+        max_lateness = sleepers[i].lateness;
+    }
+
+  msg ("%d sleepers, latest woke %"PRId64" ticks late", SLEEPER_CNT,
+       max_lateness);
+  msg ("longest timer interrupt: %"PRIu64" cycles",
+       timer_max_interrupt_cycles ());
+  pass ();
+}
+
+/* Sleeps for the duration given in S_ and records how late it
+   woke up. */
+static void
+sleeper_thread (void *s_) 
+{
+  struct sleeper *s = s_;
+  int64_t start = timer_ticks ();
+  int64_t elapsed;
+
+  timer_sleep (s->duration);
+  elapsed = timer_elapsed (start);
+  s->lateness = elapsed < s->duration ? -1 : elapsed - s->duration;
+  sema_up (&done);
+}
@@ -0,0 +1,39 @@
+/* Checks that with the -tickless option, a sleep while no other
+   thread is runnable lasts exactly as many ticks as asked for,
+   as counted by timer_ticks(), even though far fewer timer
+   interrupts arrive in the meantime. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/devices/tests.h"
+#include "threads/init.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Ticks to sleep. */
+#define SLEEP_TICKS 100
+
+void
+test_alarm_tickless (void) 
+{
+  int64_t start, start_interrupts, elapsed, interrupts;
+
+  ASSERT (timer_tickless);
+
+  /* Start out right after a tick. */
+  timer_sleep (1);
+
+  start = timer_ticks ();
+  start_interrupts = timer_interrupts ();
+  timer_sleep (SLEEP_TICKS);
+  elapsed = timer_elapsed (start);
+  interrupts = timer_interrupts () - start_interrupts;
+
+  msg ("slept %"PRId64" ticks with %"PRId64" timer interrupts",
+       elapsed, interrupts);
+  if (elapsed < SLEEP_TICKS || elapsed > SLEEP_TICKS + 1)
+    fail ("asked for %d ticks", SLEEP_TICKS);
+  if (interrupts >= SLEEP_TICKS / 2)
+    fail ("timer tick was not stopped while idle");
+  pass ();
+}
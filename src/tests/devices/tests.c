@@ -18,7 +18,10 @@ static const struct test tests[] =
     {"alarm-no-busy-wait", test_alarm_no_busy_wait},
     {"alarm-one",          test_alarm_one},
     {"alarm-zero",         test_alarm_zero},
-    {"alarm-negative",     test_alarm_negative}
+    {"alarm-negative",     test_alarm_negative},
+    {"alarm-stress",       test_alarm_stress},
+    {"alarm-tickless",     test_alarm_tickless},
+    {"alarm-hires",        test_alarm_hires}
   };
 #else
 static const struct test tests[] = 
@@ -30,6 +33,9 @@ static const struct test tests[] =
     {"alarm-one",          test_alarm_one},
     {"alarm-zero",         test_alarm_zero},
     {"alarm-negative",     test_alarm_negative},      
+    {"alarm-stress",       test_alarm_stress},
+    {"alarm-tickless",     test_alarm_tickless},
+    {"alarm-hires",        test_alarm_hires},
     {"alarm-priority", test_alarm_priority},
     {"priority-change", test_priority_change},
     {"priority-donate-one", test_priority_donate_one},
@@ -53,6 +59,10 @@ static const struct test tests[] =
     {"mlfqs-nice-2", test_mlfqs_nice_2},
     {"mlfqs-nice-10", test_mlfqs_nice_10},
     {"mlfqs-block", test_mlfqs_block},
+    {"bench-sched-pick", test_bench_sched_pick},
+    {"bench-sema-wake", test_bench_sema_wake},
+    {"bench-palloc", test_bench_palloc},
+    {"bench-palloc-ff", test_bench_palloc},
   };  
 #endif
 
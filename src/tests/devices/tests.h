@@ -12,6 +12,9 @@ extern test_func test_alarm_no_busy_wait;
 extern test_func test_alarm_one;
 extern test_func test_alarm_zero;
 extern test_func test_alarm_negative;
+extern test_func test_alarm_stress;
+extern test_func test_alarm_tickless;
+extern test_func test_alarm_hires;
 
 #ifdef THREADS
 extern test_func test_alarm_priority;
@@ -37,6 +40,9 @@ extern test_func test_mlfqs_fair_20;
 extern test_func test_mlfqs_nice_2;
 extern test_func test_mlfqs_nice_10;
 extern test_func test_mlfqs_block;
+extern test_func test_bench_sched_pick;
+extern test_func test_bench_sema_wake;
+extern test_func test_bench_palloc;
 #endif
 
 void msg (const char *, ...);
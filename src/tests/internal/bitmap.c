@@ -0,0 +1,182 @@
+/* Test program for lib/kernel/bitmap.c.
+
+   Checks bitmap_scan(), bitmap_count(), and bitmap_contains()
+   against straightforward bit-at-a-time versions on random
+   bitmaps, with and without a summary, then times scans on a
+   near-full and on a fragmented bitmap.
+
+   This is not a test we will run on your submitted tasks.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <bitmap.h>
+#include <debug.h>
+#include <random.h>
+#include <stdio.h>
+#include "devices/timer.h"
+#include "threads/test.h"
+
+/* Largest bitmap, in bits, for the correctness tests. */
+#define MAX_BITS 300
+
+/* Size of the bitmaps used for timing: 4 MB worth of pages. */
+#define BENCH_BITS 1024
+
+/* Size of the near-full bitmap used for timing, in bits: one
+   bit per sector of a 512 MB disk. */
+#define BIG_BITS (1024 * 1024)
+
+static void test_random (bool summary);
+static void bench_near_full (void);
+static void bench_fragmented (void);
+static size_t slow_scan (const struct bitmap *, size_t start, size_t cnt,
+                         bool value);
+static uint64_t time_scans (const struct bitmap *, size_t cnt, bool value,
+                            int reps);
+
+/* Test the bitmap implementation. */
+void
+test (void) 
+{
+  printf ("testing random bitmaps without summary...");
+  test_random (false);
+  printf (" done\n");
+
+  printf ("testing random bitmaps with summary...");
+  test_random (true);
+  printf (" done\n");
+
+  bench_near_full ();
+  bench_fragmented ();
+  printf ("bitmap: PASS\n");
+}
+
+/* Fills random bitmaps with random runs and scattered flips,
+   then checks scans, counts, and containment tests at random
+   positions against bit-at-a-time versions. */
+static void
+test_random (bool summary) 
+{
+  int iter;
+
+  for (iter = 0; iter < 2000; iter++) 
+    {
+      size_t bit_cnt = random_ulong () % MAX_BITS;
+      struct bitmap *b = bitmap_create (bit_cnt);
+      int density = random_ulong () % 101;
+      size_t i;
+      int j;
+
+      ASSERT (b != NULL);
+      ASSERT (!summary || bitmap_enable_summary (b));
+
+      for (j = 0; j < 5 && bit_cnt > 0; j++) 
+        {
+          size_t start = random_ulong () % bit_cnt;
+          size_t cnt = random_ulong () % (bit_cnt - start + 1);
+          bitmap_set_multiple (b, start, cnt,
+                               (int) (random_ulong () % 100) < density);
+        }
+      for (i = 0; i < bit_cnt; i++)
+        if (random_ulong () % 10 == 0)
+          bitmap_flip (b, i);
+
+      for (j = 0; j < 20; j++) 
+        {
+          size_t start = random_ulong () % (bit_cnt + 1);
+          size_t cnt = random_ulong () % 12;
+          bool value = random_ulong () % 2;
+          size_t range = start + cnt <= bit_cnt ? cnt : bit_cnt - start;
+          size_t value_cnt = 0;
+
+          ASSERT (bitmap_scan (b, start, cnt, value)
+                  == slow_scan (b, start, cnt, value));
+
+          for (i = start; i < start + range; i++)
+            if (bitmap_test (b, i) == value)
+              value_cnt++;
+          ASSERT (bitmap_count (b, start, range, value) == value_cnt);
+          ASSERT (bitmap_contains (b, start, range, value)
+                  == (value_cnt > 0));
+        }
+      bitmap_destroy (b);
+    }
+}
+
+/* Times single-bit scans for a false bit in a large bitmap with
+   only its last bit false, as on a nearly full disk. */
+static void
+bench_near_full (void) 
+{
+  struct bitmap *b = bitmap_create (BIG_BITS);
+  uint64_t plain, summary;
+
+  ASSERT (b != NULL);
+  bitmap_set_all (b, true);
+  bitmap_reset (b, BIG_BITS - 1);
+
+  plain = time_scans (b, 1, false, 4);
+  ASSERT (bitmap_enable_summary (b));
+  summary = time_scans (b, 1, false, 4);
+  printf ("near-full map of %d bits: %llu cycles per scan, "
+          "%llu with summary\n", BIG_BITS, plain, summary);
+  bitmap_destroy (b);
+}
+
+/* Times scans for 8 false bits in a bitmap whose false bits come
+   in runs of 1 to 7, as in a fragmented page pool, and compares
+   them with scanning a bit at a time. */
+static void
+bench_fragmented (void) 
+{
+  struct bitmap *b = bitmap_create (BENCH_BITS);
+  uint64_t start, slow, fast;
+  size_t i;
+
+  ASSERT (b != NULL);
+  for (i = 0; i < BENCH_BITS; i += 8)
+    bitmap_set_multiple (b, i, 1 + random_ulong () % 7, true);
+  bitmap_set_multiple (b, BENCH_BITS - 8, 8, false);
+
+  start = timer_tsc ();
+  ASSERT (slow_scan (b, 0, 8, false) == BENCH_BITS - 8);
+  slow = timer_tsc () - start;
+  fast = time_scans (b, 8, false, 4);
+  printf ("fragmented map of %d bits: %llu cycles per scan, "
+          "%llu bit at a time\n", BENCH_BITS, fast, slow);
+  bitmap_destroy (b);
+}
+
+/* Returns the starting index of the first group of CNT bits at
+   or after START in B that are all set to VALUE, testing one
+   bit at a time, or BITMAP_ERROR if there is none. */
+static size_t
+slow_scan (const struct bitmap *b, size_t start, size_t cnt, bool value) 
+{
+  size_t bit_cnt = bitmap_size (b);
+  size_t i, j;
+
+  for (i = start; cnt <= bit_cnt && i <= bit_cnt - cnt; i++) 
+    {
+      for (j = 0; j < cnt; j++)
+        if (bitmap_test (b, i + j) != value)
+          break;
+      if (j == cnt)
+        return i;
+    }
+  return BITMAP_ERROR;
+}
+
+/* Returns the average number of cycles taken by REPS scans of B
+   for CNT bits set to VALUE. */
+static uint64_t
+time_scans (const struct bitmap *b, size_t cnt, bool value, int reps) 
+{
+  uint64_t start = timer_tsc ();
+  int i;
+
+  for (i = 0; i < reps; i++)
+    ASSERT (bitmap_scan (b, 0, cnt, value) != BITMAP_ERROR);
+  return (timer_tsc () - start) / reps;
+}
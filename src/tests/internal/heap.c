@@ -0,0 +1,146 @@
+/* Test program for lib/kernel/heap.c.
+
+   Attempts to test the heap functionality that is not
+   sufficiently tested elsewhere in Pintos.
+
+   This is not a test we will run on your submitted tasks.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <heap.h>
+#include <random.h>
+#include <stdio.h>
+#include "threads/test.h"
+
+/* Maximum number of elements in a heap that we will test. */
+#define MAX_SIZE 64
+
+/* A heap element. */
+struct value 
+  {
+    struct heap_elem elem;      /* Heap element. */
+    int value;                  /* Item value. */
+    bool in_heap;               /* Currently in the heap? */
+  };
+
+static void shuffle (struct value[], size_t);
+static bool value_less (const struct heap_elem *, const struct heap_elem *,
+                        void *);
+static void verify_heap_drain (struct heap *, int max, int cnt);
+
+/* Test the heap implementation. */
+void
+test (void) 
+{
+  int size;
+
+  printf ("testing various size heaps:");
+  for (size = 0; size < MAX_SIZE; size++) 
+    {
+      int repeat;
+
+      printf (" %d", size);
+      for (repeat = 0; repeat < 10; repeat++) 
+        {
+          static struct value values[MAX_SIZE];
+          struct heap heap;
+          int i, removed;
+
+          /* Put values 0...SIZE in random order in VALUES. */
+          for (i = 0; i < size; i++)
+            values[i].value = i;
+          shuffle (values, size);
+
+          /* Build heap and verify that it drains in order. */
+          heap_init (&heap, value_less, NULL);
+          for (i = 0; i < size; i++)
+            heap_push (&heap, &values[i].elem);
+          ASSERT (heap_size (&heap) == (size_t) size);
+          verify_heap_drain (&heap, size - 1, size);
+
+          /* Rebuild, remove a random half of the elements, and
+             verify the rest still drain in order. */
+          shuffle (values, size);
+          heap_init (&heap, value_less, NULL);
+          for (i = 0; i < size; i++)
+            {
+              heap_push (&heap, &values[i].elem);
+              values[i].in_heap = true;
+            }
+          for (i = removed = 0; i < size; i++)
+            if (random_ulong () % 2 && values[i].value != size - 1)
+              {
+                heap_remove (&heap, &values[i].elem);
+                values[i].in_heap = false;
+                removed++;
+              }
+          ASSERT (heap_size (&heap) == (size_t) (size - removed));
+          verify_heap_drain (&heap, size - 1, size - removed);
+
+          /* Rebuild with all values 0, then raise them back to
+             0...SIZE one at a time with heap_increase(). */
+          heap_init (&heap, value_less, NULL);
+          for (i = 0; i < size; i++)
+            {
+              values[i].value = 0;
+              heap_push (&heap, &values[i].elem);
+            }
+          for (i = 0; i < size; i++)
+            {
+              values[i].value = i;
+              heap_increase (&heap, &values[i].elem);
+            }
+          verify_heap_drain (&heap, size - 1, size);
+        }
+    }
+  
+  printf (" done\n");
+  printf ("heap: PASS\n");
+}
+
+/* Shuffles the CNT elements in ARRAY into random order. */
+static void
+shuffle (struct value *array, size_t cnt) 
+{
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    {
+      size_t j = i + random_ulong () % (cnt - i);
+      struct value t = array[j];
+      array[j] = array[i];
+      array[i] = t;
+    }
+}
+
+/* Returns true if value A is less than value B, false
+   otherwise. */
+static bool
+value_less (const struct heap_elem *a_, const struct heap_elem *b_,
+            void *aux UNUSED) 
+{
+  const struct value *a = heap_entry (a_, struct value, elem);
+  const struct value *b = heap_entry (b_, struct value, elem);
+  
+  return a->value < b->value;
+}
+
+/* Verifies that popping HEAP yields CNT values in decreasing
+   order, starting from MAX, and then leaves HEAP empty. */
+static void
+verify_heap_drain (struct heap *heap, int max, int cnt) 
+{
+  int prev = max + 1;
+  int i;
+
+  for (i = 0; i < cnt; i++) 
+    {
+      struct value *v = heap_entry (heap_pop (heap), struct value, elem);
+      ASSERT (v->value < prev);
+      ASSERT (i != 0 || v->value == max);
+      prev = v->value;
+    }
+  ASSERT (heap_empty (heap));
+}
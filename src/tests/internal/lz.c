@@ -0,0 +1,90 @@
+/* Test program for lib/kernel/lz.c.
+
+   Compresses buffers of several kinds, from all zeros to random
+   bytes, checks that they decompress to the original, and that
+   the compressor and decompressor respect their capacities.
+
+   This is not a test we will run on your submitted tasks.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <lz.h>
+#include <random.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/test.h"
+
+/* Size of the buffers we test. */
+#define SIZE 4096
+
+/* Number of kinds of buffer. */
+#define KIND_CNT 4
+
+static void fill (uint8_t *, size_t size, int kind);
+
+/* Test the LZ compressor. */
+void
+test (void) 
+{
+  static uint8_t in[SIZE], out[SIZE], packed[SIZE + SIZE / 16];
+  static uint16_t work[LZ_WORK_SIZE / sizeof (uint16_t)];
+  int trial;
+
+  for (trial = 0; trial < 400; trial++) 
+    {
+      int kind = trial % KIND_CNT;
+      size_t size = trial < KIND_CNT ? SIZE : random_ulong () % (SIZE + 1);
+      size_t packed_size;
+
+      fill (in, size, kind);
+      packed_size = lz_compress (in, size, packed, sizeof packed, work);
+      ASSERT (packed_size > 0 && packed_size <= sizeof packed);
+      ASSERT (lz_decompress (packed, packed_size, out, SIZE) == size);
+      ASSERT (!memcmp (in, out, size));
+
+      /* Too little room either way must be noticed. */
+      ASSERT (lz_compress (in, size, packed, packed_size - 1, work) == 0);
+      ASSERT (size == 0
+              || lz_decompress (packed, packed_size, out, size - 1)
+                 == SIZE_MAX);
+
+      if (trial < KIND_CNT)
+        printf ("kind %d: %zu bytes compress to %zu\n",
+                kind, size, packed_size);
+    }
+  printf ("lz: PASS\n");
+}
+
+/* Fills the SIZE bytes at P with data of the given KIND. */
+static void
+fill (uint8_t *p, size_t size, int kind) 
+{
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    switch (kind) 
+      {
+      case 0:
+        /* Zeros. */
+        p[i] = 0;
+        break;
+
+      case 1:
+        /* Random bytes. */
+        p[i] = random_ulong ();
+        break;
+
+      case 2:
+        /* Short repeated runs with random bytes mixed in. */
+        p[i] = i % 37 < 5 ? random_ulong () : 'a' + i % 3;
+        break;
+
+      default:
+        /* Copies of random earlier bytes. */
+        p[i] = i < 64 ? random_ulong () : p[i - 1 - random_ulong () % 64];
+        break;
+      }
+}
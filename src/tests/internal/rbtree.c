@@ -0,0 +1,163 @@
+/* Test program for lib/kernel/rbtree.c.
+
+   Inserts and removes random values, checking after each step
+   that lookups agree with a plain array and, periodically, that
+   the tree is still ordered and balanced.
+
+   This is not a test we will run on your submitted tasks.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <random.h>
+#include <rbtree.h>
+#include <stdio.h>
+#include "threads/test.h"
+
+/* Number of distinct values in the trees we test. */
+#define MAX_SIZE 256
+
+/* A tree element. */
+struct value 
+  {
+    struct rb_elem elem;        /* Tree element. */
+    int value;                  /* Item value. */
+    bool in_tree;               /* Currently in the tree? */
+  };
+
+static bool value_less (const struct rb_elem *, const struct rb_elem *,
+                        void *);
+static int check_subtree (const struct rb_elem *,
+                          const struct rb_elem *parent, size_t *cnt);
+static void check_tree (const struct rb_tree *, struct value[]);
+static void count_value (struct rb_elem *, void *);
+
+/* Test the red-black tree implementation. */
+void
+test (void) 
+{
+  static struct value values[MAX_SIZE];
+  struct rb_tree tree;
+  size_t cleared = 0;
+  int i;
+
+  printf ("testing random insertions and removals...");
+  rb_init (&tree, value_less, &cleared);
+  for (i = 0; i < MAX_SIZE; i++)
+    {
+      values[i].value = i;
+      values[i].in_tree = false;
+    }
+
+  for (i = 0; i < 20000; i++) 
+    {
+      struct value *v = &values[random_ulong () % MAX_SIZE];
+      struct value key;
+      struct rb_elem *e;
+      int j;
+
+      if (v->in_tree)
+        rb_remove (&tree, &v->elem);
+      else
+        ASSERT (rb_insert (&tree, &v->elem) == NULL);
+      v->in_tree = !v->in_tree;
+
+      key.value = random_ulong () % MAX_SIZE;
+      e = rb_find (&tree, &key.elem);
+      ASSERT ((e != NULL) == values[key.value].in_tree);
+
+      e = rb_lower_bound (&tree, &key.elem);
+      for (j = key.value; j < MAX_SIZE && !values[j].in_tree; j++)
+        continue;
+      ASSERT (j < MAX_SIZE ? e == &values[j].elem : e == NULL);
+
+      if (i % 100 == 0)
+        check_tree (&tree, values);
+    }
+  check_tree (&tree, values);
+
+  i = rb_size (&tree);
+  rb_clear (&tree, count_value);
+  ASSERT ((int) cleared == i);
+  ASSERT (rb_empty (&tree));
+  printf (" done\n");
+  printf ("rbtree: PASS\n");
+}
+
+/* Checks that TREE holds exactly the VALUES marked in_tree, that
+   in-order traversal visits them in order both ways, and that
+   the red-black properties hold. */
+static void
+check_tree (const struct rb_tree *tree, struct value values[]) 
+{
+  struct rb_elem *e;
+  size_t cnt = 0;
+  int i;
+
+  ASSERT (!tree->root || !tree->root->red);
+  check_subtree (tree->root, NULL, &cnt);
+  ASSERT (cnt == rb_size (tree));
+
+  e = rb_first (tree);
+  for (i = 0; i < MAX_SIZE; i++)
+    if (values[i].in_tree)
+      {
+        ASSERT (e == &values[i].elem);
+        e = rb_next (e);
+      }
+  ASSERT (e == NULL);
+
+  e = rb_last (tree);
+  for (i = MAX_SIZE - 1; i >= 0; i--)
+    if (values[i].in_tree)
+      {
+        ASSERT (e == &values[i].elem);
+        e = rb_prev (e);
+      }
+  ASSERT (e == NULL);
+}
+
+/* Checks the subtree rooted at E, whose parent should be PARENT,
+   adds its size to *CNT, and returns its black height. */
+static int
+check_subtree (const struct rb_elem *e, const struct rb_elem *parent,
+               size_t *cnt) 
+{
+  int left, right;
+
+  if (e == NULL)
+    return 1;
+  ASSERT (e->parent == parent);
+  ASSERT (!e->red || ((e->left == NULL || !e->left->red)
+                       && (e->right == NULL || !e->right->red)));
+
+  left = check_subtree (e->left, e, cnt);
+  right = check_subtree (e->right, e, cnt);
+  ASSERT (left == right);
+  (*cnt)++;
+  return left + !e->red;
+}
+
+/* Returns true if value A is less than value B, false
+   otherwise. */
+static bool
+value_less (const struct rb_elem *a_, const struct rb_elem *b_,
+            void *aux UNUSED) 
+{
+  const struct value *a = rb_entry (a_, struct value, elem);
+  const struct value *b = rb_entry (b_, struct value, elem);
+
+  return a->value < b->value;
+}
+
+/* Counts element E as it is cleared, in the size_t that AUX
+   points to. */
+static void
+count_value (struct rb_elem *e, void *aux) 
+{
+  size_t *cleared = aux;
+
+  rb_entry (e, struct value, elem)->in_tree = false;
+  (*cleared)++;
+}
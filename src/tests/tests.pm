@@ -32,6 +32,37 @@ sub check_expected {
     compare_output ("run", @options, \@output, $expected);
 }
 
+# Checks the output of a benchmark, which must have run to
+# completion, printing "(TEST) end" or "(TEST) PASS" and, if it is
+# a user program, exiting with status 0.  Each of REGEXES must
+# match a line of its output, less the "(TEST) " prefix.  Returns
+# the figures the regexes capture, each of which must be positive.
+sub check_benchmark {
+    my (@regexes) = @_;
+    my ($name) = $test =~ /([^\/]+)$/;
+    my (@output) = read_text_file ("$test.output");
+    common_checks ("run", @output);
+    @output = get_core_output ("run", @output);
+
+    fail "missing end in output\n"
+      unless grep ($_ eq "($name) end" || $_ eq "($name) PASS", @output);
+    my ($exit) = grep (/^\Q$name\E: exit\(/, @output);
+    fail "wrong exit code: $exit\n"
+      if defined ($exit) && $exit ne "$name: exit(0)";
+
+    my (@figures);
+    for my $regex (@regexes) {
+	my ($line) = grep (/^\(\Q$name\E\) $regex$/, @output);
+	fail "missing result in output: $regex\n" if !defined $line;
+	my (@values) = $line =~ /^\(\Q$name\E\) $regex$/;
+	for my $value (@values) {
+	    fail "implausible result: $line\n" if $value <= 0;
+	}
+	push (@figures, @values);
+    }
+    return @figures;
+}
+
 sub common_checks {
     my ($run, @output) = @_;
 
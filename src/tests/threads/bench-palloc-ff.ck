@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+my ($alloc_avg, $alloc_max, $free_avg, $free_max) = check_benchmark
+  (qr/\d+ allocations, \d+ failed: avg (\d+), max (\d+) cycles/,
+   qr/\d+ frees: avg (\d+), max (\d+) cycles/);
+fail "average above maximum\n"
+  if $alloc_avg > $alloc_max || $free_avg > $free_max;
+pass;
@@ -0,0 +1,125 @@
+/* Churns the user pool with a random mix of multi-page
+   allocations and frees, then reports the cost of each
+   operation in TSC cycles and how fragmented the pool has
+   become, as the largest block that can still be allocated.
+   Run as bench-palloc for the buddy allocator and as
+   bench-palloc-ff for first fit. */
+
+#include <random.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "devices/timer.h"
+#include "threads/palloc.h"
+
+/* Number of blocks held at once, at most. */
+#define SLOT_CNT 32
+
+/* Largest block requested, in pages. */
+#define MAX_PAGES 9
+
+/* Number of allocate-or-free operations. */
+#define OP_CNT 20000
+
+struct slot 
+  {
+    void *pages;                /* Allocated block, or null. */
+    size_t page_cnt;            /* Pages in block. */
+  };
+
+static size_t largest_allocatable (void);
+
+void
+test_bench_palloc (void) 
+{
+  static struct slot slots[SLOT_CNT];
+  uint64_t alloc_cycles = 0, free_cycles = 0;
+  uint64_t alloc_max = 0, free_max = 0;
+  unsigned alloc_cnt = 0, free_cnt = 0, fail_cnt = 0;
+  size_t held = 0;
+  int i;
+
+  random_init (0);
+  for (i = 0; i < OP_CNT; i++) 
+    {
+      struct slot *s = &slots[random_ulong () % SLOT_CNT];
+      uint64_t start, cycles;
+
+      if (s->pages != NULL) 
+        {
+          start = timer_tsc ();
+          palloc_free_multiple (s->pages, s->page_cnt);
+          cycles = timer_tsc () - start;
+
+          free_cycles += cycles;
+          if (cycles > free_max)
+            free_max = cycles;
+          free_cnt++;
+          held -= s->page_cnt;
+          s->pages = NULL;
+        }
+      else 
+        {
+          s->page_cnt = random_ulong () % MAX_PAGES + 1;
+          start = timer_tsc ();
+          s->pages = palloc_get_multiple (PAL_USER, s->page_cnt);
+          cycles = timer_tsc () - start;
+
+          if (s->pages == NULL) 
+            {
+              fail_cnt++;
+              continue;
+            }
+          alloc_cycles += cycles;
+          if (cycles > alloc_max)
+            alloc_max = cycles;
+          alloc_cnt++;
+          held += s->page_cnt;
+        }
+    }
+
+  msg ("backend: %s", palloc_first_fit ? "first fit" : "buddy");
+  msg ("%u allocations, %u failed: avg %llu, max %llu cycles",
+       alloc_cnt, fail_cnt, alloc_cycles / (alloc_cnt ? alloc_cnt : 1),
+       alloc_max);
+  msg ("%u frees: avg %llu, max %llu cycles",
+       free_cnt, free_cycles / (free_cnt ? free_cnt : 1), free_max);
+  msg ("%zu pages held, largest allocatable block %zu pages",
+       held, largest_allocatable ());
+
+  for (i = 0; i < SLOT_CNT; i++)
+    if (slots[i].pages != NULL)
+      palloc_free_multiple (slots[i].pages, slots[i].page_cnt);
+  pass ();
+}
+
+/* Returns the number of pages in the largest block that can be
+   allocated from the user pool, found by binary search. */
+static size_t
+largest_allocatable (void) 
+{
+  size_t lo = 0, hi = 1;
+  void *pages;
+
+  /* Find an upper bound. */
+  while ((pages = palloc_get_multiple (PAL_USER, hi)) != NULL) 
+    {
+      palloc_free_multiple (pages, hi);
+      lo = hi;
+      hi *= 2;
+    }
+
+  /* LO can be allocated and HI cannot. */
+  while (hi - lo > 1) 
+    {
+      size_t mid = lo + (hi - lo) / 2;
+      pages = palloc_get_multiple (PAL_USER, mid);
+      if (pages != NULL) 
+        {
+          palloc_free_multiple (pages, mid);
+          lo = mid;
+        }
+      else
+        hi = mid;
+    }
+  return lo;
+}
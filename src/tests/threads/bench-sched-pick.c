@@ -0,0 +1,97 @@
+/* Measures the cost of a context switch between two threads at
+   the top priority while a growing number of lower-priority
+   threads sit in the run queue.  With a bitmap-indexed run queue
+   the scheduler's pick does not depend on how many threads are
+   ready, so the cost per switch should stay flat. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+
+/* Number of ping-pong switches timed for each run. */
+#define SWITCH_CNT 1000
+
+/* Allowed ratio between the slowest and the fastest run. */
+#define MAX_SLOWDOWN 4
+
+static thread_func partner_thread;
+static thread_func filler_thread;
+static uint64_t rdtsc (void);
+
+static volatile bool done;
+
+void
+test_bench_sched_pick (void) 
+{
+  static const int ready_cnts[] = {0, 8, 32, 64, 128};
+  const int run_cnt = sizeof ready_cnts / sizeof *ready_cnts;
+  uint64_t min_cost = UINT64_MAX, max_cost = 0;
+  int i, j;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  for (i = 0; i < run_cnt; i++) 
+    {
+      uint64_t start, cost;
+
+      /* Fill the run queue with threads that never get to run
+         while we and our partner are runnable. */
+      for (j = 0; j < ready_cnts[i]; j++)
+        thread_create ("filler", PRI_DEFAULT - 1 - j % 8, filler_thread, NULL);
+
+      done = false;
+      thread_create ("partner", PRI_DEFAULT, partner_thread, NULL);
+
+      start = rdtsc ();
+      for (j = 0; j < SWITCH_CNT / 2; j++)
+        thread_yield ();
+      cost = (rdtsc () - start) / SWITCH_CNT;
+
+      /* Let the partner, and then the fillers, run to completion. */
+      done = true;
+      thread_yield ();
+      thread_set_priority (PRI_MIN);
+      thread_set_priority (PRI_DEFAULT);
+
+      msg ("%d ready threads: %d cycles per switch",
+           ready_cnts[i], (int) cost);
+      if (cost < min_cost)
+        min_cost = cost;
+      if (cost > max_cost)
+        max_cost = cost;
+    }
+
+  if (max_cost > min_cost * MAX_SLOWDOWN)
+    fail ("switch cost grew from %d to %d cycles",
+          (int) min_cost, (int) max_cost);
+  pass ();
+}
+
+/* Yields back to the main thread until told to stop. */
+static void
+partner_thread (void *aux UNUSED) 
+{
+  while (!done)
+    thread_yield ();
+}
+
+/* Exits as soon as it is scheduled. */
+static void
+filler_thread (void *aux UNUSED) 
+{
+}
+
+/* Returns the CPU's time-stamp counter. */
+static uint64_t
+rdtsc (void) 
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
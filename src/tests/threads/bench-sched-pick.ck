@@ -0,0 +1,6 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_benchmark (qr/\d+ ready threads: (\d+) cycles per switch/);
+pass;
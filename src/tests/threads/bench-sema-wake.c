@@ -0,0 +1,117 @@
+/* Measures how long it takes the highest-priority thread waiting
+   on a semaphore to start running after sema_up(), as the number
+   of waiters grows.  Waiters are created at mixed priorities in
+   a scrambled order, and each sema_up() must wake the waiter
+   with the highest priority, earliest arrival first among equal
+   priorities. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Largest number of waiters. */
+#define MAX_WAITERS 128
+
+/* Allowed ratio between the slowest and the fastest run. */
+#define MAX_SLOWDOWN 4
+
+struct waiter 
+  {
+    int priority;               /* Priority of this waiter. */
+    int seq;                    /* Order of creation. */
+  };
+
+static thread_func waiter_thread;
+static uint64_t rdtsc (void);
+
+static struct semaphore sema;
+static volatile uint64_t wake_start, wake_cost;
+static volatile int last_priority, last_seq;
+static volatile bool out_of_order;
+
+void
+test_bench_sema_wake (void) 
+{
+  static const int waiter_cnts[] = {1, 8, 32, 128};
+  const int run_cnt = sizeof waiter_cnts / sizeof *waiter_cnts;
+  static struct waiter waiters[MAX_WAITERS];
+  uint64_t min_cost = UINT64_MAX, max_cost = 0;
+  int i, j;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  sema_init (&sema, 0);
+  for (i = 0; i < run_cnt; i++) 
+    {
+      uint64_t first_cost = 0;
+
+      /* Each waiter outranks us, so it runs and blocks on SEMA as
+         soon as it is created. */
+      for (j = 0; j < waiter_cnts[i]; j++) 
+        {
+          struct waiter *w = &waiters[j];
+          w->priority = PRI_DEFAULT + 1 + (j * 7) % (PRI_MAX - PRI_DEFAULT);
+          w->seq = j;
+          thread_create ("waiter", w->priority, waiter_thread, w);
+        }
+
+      /* Wake them one at a time.  Each woken waiter preempts us,
+         records its latency, and exits. */
+      last_priority = PRI_MAX + 1;
+      last_seq = -1;
+      out_of_order = false;
+      for (j = 0; j < waiter_cnts[i]; j++) 
+        {
+          wake_start = rdtsc ();
+          sema_up (&sema);
+          if (j == 0)
+            first_cost = wake_cost;
+        }
+      if (out_of_order)
+        fail ("%d waiters: woken out of priority order", waiter_cnts[i]);
+
+      msg ("%d waiters: %d cycles from sema_up to top waiter running",
+           waiter_cnts[i], (int) first_cost);
+      if (first_cost < min_cost)
+        min_cost = first_cost;
+      if (first_cost > max_cost)
+        max_cost = first_cost;
+    }
+
+  if (max_cost > min_cost * MAX_SLOWDOWN)
+    fail ("wake latency grew from %d to %d cycles",
+          (int) min_cost, (int) max_cost);
+  pass ();
+}
+
+/* Waits on SEMA, then checks that no waiter that should have
+   come first is still waiting. */
+static void
+waiter_thread (void *w_) 
+{
+  struct waiter *w = w_;
+
+  sema_down (&sema);
+  wake_cost = rdtsc () - wake_start;
+
+  if (w->priority > last_priority
+      || (w->priority == last_priority && w->seq < last_seq))
+    out_of_order = true;
+  last_priority = w->priority;
+  last_seq = w->seq;
+}
+
+/* Returns the CPU's time-stamp counter. */
+static uint64_t
+rdtsc (void) 
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
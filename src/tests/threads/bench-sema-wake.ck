@@ -0,0 +1,7 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_benchmark
+  (qr/\d+ waiters: (\d+) cycles from sema_up to top waiter running/);
+pass;
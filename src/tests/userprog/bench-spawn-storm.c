@@ -0,0 +1,37 @@
+/* Spawns and reaps child processes back to back and reports
+   how many spawns per second the kernel sustains.  Each spawn
+   allocates and frees a thread page and the process
+   bookkeeping structures, so this exercises the object caches
+   more than anything else.  Each spawn also takes zeroed pages
+   for its page directory, page tables and stack; run as
+   bench-spawn-storm-nz, the kernel zeroes them on demand
+   instead of keeping pre-zeroed pages. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SPAWN_CNT 100
+
+void
+test_main (void) 
+{
+  int64_t start, elapsed;
+  int i;
+
+  start = time_ns ();
+  for (i = 0; i < SPAWN_CNT; i++) 
+    {
+      pid_t pid = exec ("child-simple");
+      if (pid == PID_ERROR)
+        fail ("exec failed on spawn %d", i);
+      if (wait (pid) != 81)
+        fail ("wait failed on spawn %d", i);
+    }
+  elapsed = time_ns () - start;
+  if (elapsed <= 0)
+    elapsed = 1;
+
+  msg ("%d spawns in %lld us, %lld spawns/s", SPAWN_CNT,
+       elapsed / 1000, SPAWN_CNT * 1000000000LL / elapsed);
+}
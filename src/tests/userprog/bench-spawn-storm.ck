@@ -0,0 +1,6 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_benchmark (qr/\d+ spawns in (\d+) us, (\d+) spawns\/s/);
+pass;
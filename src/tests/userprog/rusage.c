@@ -0,0 +1,28 @@
+/* Checks the resource usage reported by getrusage() for this
+   process and for a child that it has waited for. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  struct rusage self, children;
+
+  CHECK (getrusage (RUSAGE_CHILDREN, &children) == 0,
+         "getrusage (RUSAGE_CHILDREN)");
+  CHECK (children.bytes_written == 0, "no children yet");
+
+  CHECK (wait (exec ("child-simple")) == 81, "wait for child-simple");
+  CHECK (getrusage (RUSAGE_CHILDREN, &children) == 0,
+         "getrusage (RUSAGE_CHILDREN)");
+  CHECK (children.bytes_written > 0, "child's output is counted");
+
+  CHECK (getrusage (RUSAGE_SELF, &self) == 0, "getrusage (RUSAGE_SELF)");
+  CHECK (self.bytes_written > children.bytes_written,
+         "own output is counted separately");
+  CHECK (self.voluntary_switches > 0, "blocking in wait is counted");
+
+  CHECK (getrusage (1234, &self) == -1, "bad WHO is rejected");
+}
@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rusage) begin
+(rusage) getrusage (RUSAGE_CHILDREN)
+(rusage) no children yet
+(child-simple) run
+child-simple: exit(81)
+(rusage) wait for child-simple
+(rusage) getrusage (RUSAGE_CHILDREN)
+(rusage) child's output is counted
+(rusage) getrusage (RUSAGE_SELF)
+(rusage) own output is counted separately
+(rusage) blocking in wait is counted
+(rusage) bad WHO is rejected
+(rusage) end
+rusage: exit(0)
+EOF
+pass;
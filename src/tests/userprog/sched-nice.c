@@ -0,0 +1,20 @@
+/* Sets this process's nice value through the system call
+   interface, reads it back, and checks that out-of-range values
+   are clamped. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  CHECK (get_nice () == 0, "initial nice is 0");
+  set_nice (5);
+  CHECK (get_nice () == 5, "nice set to 5");
+  set_nice (100);
+  CHECK (get_nice () == 20, "nice clamped to 20");
+  set_nice (-100);
+  CHECK (get_nice () == -20, "nice clamped to -20");
+  CHECK (get_load_avg () >= 0, "load average is not negative");
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(sched-nice) begin
+(sched-nice) initial nice is 0
+(sched-nice) nice set to 5
+(sched-nice) nice clamped to 20
+(sched-nice) nice clamped to -20
+(sched-nice) load average is not negative
+(sched-nice) end
+sched-nice: exit(0)
+EOF
+pass;
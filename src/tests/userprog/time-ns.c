@@ -0,0 +1,24 @@
+/* Reads the nanosecond clock through the system call interface
+   and checks that it runs forward. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  int64_t start = time_ns ();
+  int64_t prev = start, now;
+  int i;
+
+  CHECK (start > 0, "clock has started");
+  for (i = 0; i < 1000; i++) 
+    {
+      now = time_ns ();
+      if (now < prev)
+        fail ("clock went backward");
+      prev = now;
+    }
+  CHECK (prev > start, "clock runs forward");
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(time-ns) begin
+(time-ns) clock has started
+(time-ns) clock runs forward
+(time-ns) end
+time-ns: exit(0)
+EOF
+pass;
@@ -0,0 +1,42 @@
+/* Measures the time from exec() to the first statement of a
+   child with a large executable.  Under demand paging only the
+   pages the child touches are read in; run as
+   bench-exec-latency-eager, the kernel reads the whole executable
+   at load time instead. */
+
+#include <limits.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define EXEC_CNT 10
+
+void
+test_main (void) 
+{
+  long long total = 0;
+  int best = INT_MAX;
+  int i;
+
+  for (i = 0; i < EXEC_CNT; i++) 
+    {
+      char cmd[32];
+      pid_t pid;
+      int latency;
+
+      snprintf (cmd, sizeof cmd, "child-big %lld", time_ns () / 1000);
+      pid = exec (cmd);
+      if (pid == PID_ERROR)
+        fail ("exec failed on run %d", i);
+      latency = wait (pid);
+      if (latency < 0)
+        fail ("bad latency %d on run %d", latency, i);
+      total += latency;
+      if (latency < best)
+        best = latency;
+    }
+
+  msg ("exec to first instruction: %lld us average, %d us best "
+       "over %d runs", total / EXEC_CNT, best, EXEC_CNT);
+}
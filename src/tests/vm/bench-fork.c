@@ -0,0 +1,46 @@
+/* Measures the time fork() takes in a process with 1 MB of
+   resident data.  With copy-on-write the child shares the data
+   instead of copying it, so the cost follows the number of page
+   table entries, not the bytes behind them.  The child exits at
+   once without touching the data. */
+
+#include <limits.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (1024 * 1024)
+#define FORK_CNT 10
+
+static char buf[SIZE];
+
+void
+test_main (void) 
+{
+  long long total = 0;
+  int best = INT_MAX;
+  int i;
+
+  memset (buf, 0x5a, sizeof buf);
+  for (i = 0; i < FORK_CNT; i++) 
+    {
+      int64_t start = time_ns ();
+      pid_t pid = fork ();
+      int latency;
+
+      if (pid == 0)
+        exit (0);
+      latency = (time_ns () - start) / 1000;
+      if (pid == PID_ERROR)
+        fail ("fork failed on run %d", i);
+      if (wait (pid) != 0)
+        fail ("bad exit code on run %d", i);
+      total += latency;
+      if (latency < best)
+        best = latency;
+    }
+
+  msg ("fork with 1 MB resident: %lld us average, %d us best "
+       "over %d runs", total / FORK_CNT, best, FORK_CNT);
+}
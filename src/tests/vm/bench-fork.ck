@@ -0,0 +1,8 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+my ($average, $best) = check_benchmark
+  (qr/fork with 1 MB resident: (\d+) us average, (\d+) us best over \d+ runs/);
+fail "best run slower than the average\n" if $best > $average;
+pass;
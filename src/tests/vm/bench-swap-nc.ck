@@ -0,0 +1,7 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_benchmark (qr/sequential: (\d+) us, (\d+) KB\/s/,
+                 qr/random: (\d+) us, (\d+) KB\/s/);
+pass;
@@ -0,0 +1,64 @@
+/* Measures swap throughput for sequential and for random access
+   to 2 MB of memory, more than fits in the frames left to user
+   processes.  Each pass writes to every page it touches, so the
+   pages it displaces must be written out again.  The pages are
+   nearly all zeros, so both runs turn the compressed swap cache
+   off to make the pages reach the swap device.  Run as
+   bench-swap-nc, the kernel swaps pages one at a time without
+   clustering or read-ahead. */
+
+#include <random.h>
+#include <stdint.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGE_CNT 512
+#define SIZE (PAGE_CNT * PAGE_SIZE)
+
+static char buf[SIZE];
+
+/* Touches page PAGE, checking and then bumping its counter. */
+static void
+touch (size_t page, unsigned char *expect) 
+{
+  unsigned char *p = (unsigned char *) buf + page * PAGE_SIZE;
+
+  if (*p != expect[page])
+    fail ("page %zu holds %d, not %d", page, *p, expect[page]);
+  *p = ++expect[page];
+}
+
+/* Reports the throughput of touching PAGE_CNT pages in NS
+   nanoseconds. */
+static void
+report (const char *pass, int64_t ns) 
+{
+  int64_t us = ns / 1000 > 0 ? ns / 1000 : 1;
+
+  msg ("%s: %lld us, %lld KB/s", pass, us,
+       (long long) SIZE / 1024 * 1000000 / us);
+}
+
+void
+test_main (void) 
+{
+  static unsigned char expect[PAGE_CNT];
+  int64_t start;
+  size_t i;
+
+  /* Fault every page in, pushing the start of the buffer out. */
+  for (i = 0; i < PAGE_CNT; i++)
+    touch (i, expect);
+
+  start = time_ns ();
+  for (i = 0; i < PAGE_CNT; i++)
+    touch (i, expect);
+  report ("sequential", time_ns () - start);
+
+  random_init (0);
+  start = time_ns ();
+  for (i = 0; i < PAGE_CNT; i++)
+    touch (random_ulong () % PAGE_CNT, expect);
+  report ("random", time_ns () - start);
+}
@@ -0,0 +1,23 @@
+/* Child process of bench-exec-latency.
+   Carries 256 kB of initialized data, so that loading it eagerly
+   means reading 64 pages it never touches.  Exits with the number
+   of microseconds between the start time passed as argv[1] and
+   its first statement. */
+
+#include <stdlib.h>
+#include <syscall.h>
+
+#define DATA_SIZE (256 * 1024)
+
+/* Never read, only loaded. */
+const char big_data[DATA_SIZE] = { 1 };
+
+int
+main (int argc, char *argv[]) 
+{
+  int64_t now = time_ns () / 1000;
+
+  if (argc != 2)
+    return -1;
+  return now - atoi (argv[1]);
+}
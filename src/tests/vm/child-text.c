@@ -0,0 +1,44 @@
+/* Child process of page-share.
+   Carries 32 pages of read-only data, each starting with its own
+   index, and checks them over and over, so that the instances
+   that page-share runs overlap.  Exits with 0x42 if every page is
+   right. */
+
+#include "tests/lib.h"
+
+const char *test_name = "child-text";
+
+#define PAGE_CNT 32
+#define PASS_CNT 1000
+
+struct text_page
+  {
+    int index;
+    char pad[4096 - sizeof (int)];
+  };
+
+static const struct text_page pages[PAGE_CNT] =
+{
+  { .index = 0 }, { .index = 1 }, { .index = 2 }, { .index = 3 },
+  { .index = 4 }, { .index = 5 }, { .index = 6 }, { .index = 7 },
+  { .index = 8 }, { .index = 9 }, { .index = 10 }, { .index = 11 },
+  { .index = 12 }, { .index = 13 }, { .index = 14 }, { .index = 15 },
+  { .index = 16 }, { .index = 17 }, { .index = 18 }, { .index = 19 },
+  { .index = 20 }, { .index = 21 }, { .index = 22 }, { .index = 23 },
+  { .index = 24 }, { .index = 25 }, { .index = 26 }, { .index = 27 },
+  { .index = 28 }, { .index = 29 }, { .index = 30 }, { .index = 31 }
+};
+
+int
+main (void)
+{
+  /* Keeps the compiler from checking the table at compile time. */
+  const struct text_page *volatile table = pages;
+  int pass, i;
+
+  for (pass = 0; pass < PASS_CNT; pass++)
+    for (i = 0; i < PAGE_CNT; i++)
+      if (table[i].index != i)
+        fail ("page %d holds index %d", i, table[i].index);
+  return 0x42;
+}
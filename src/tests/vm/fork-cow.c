@@ -0,0 +1,54 @@
+/* Forks a process with 64 kB of initialized data, then has the
+   child overwrite the even bytes and the parent the odd ones, and
+   checks that each sees only its own writes.  The child also
+   reads from a file into a page it has not written, so that the
+   kernel writes to a copy-on-write page. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (64 * 1024)
+
+static char buf[SIZE];
+static char target[4096];
+
+void
+test_main (void) 
+{
+  pid_t child;
+  int status;
+  size_t i;
+
+  memset (buf, 'p', SIZE);
+  memset (target, 't', sizeof target);
+  child = fork ();
+  if (child == 0)
+    {
+      int handle = open ("sample.txt");
+
+      for (i = 0; i < SIZE; i += 2)
+        buf[i] = 'c';
+      for (i = 0; i < SIZE; i++)
+        if (buf[i] != (i % 2 == 0 ? 'c' : 'p'))
+          exit (1);
+
+      if (handle < 2 || read (handle, target, 1) != 1 || target[0] != '=')
+        exit (2);
+      exit (81);
+    }
+  if (child == PID_ERROR)
+    fail ("fork failed");
+
+  for (i = 1; i < SIZE; i += 2)
+    buf[i] = 'q';
+  status = wait (child);
+  CHECK (status == 81, "wait for child");
+  for (i = 0; i < SIZE; i++)
+    if (buf[i] != (i % 2 == 0 ? 'p' : 'q'))
+      fail ("byte %zu is '%c'", i, buf[i]);
+  if (target[0] != 't')
+    fail ("child's read reached the parent");
+  msg ("parent's data intact");
+}
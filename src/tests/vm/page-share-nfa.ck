@@ -0,0 +1,38 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-share-nfa) begin
+(page-share-nfa) exec "child-text"
+(page-share-nfa) exec "child-text"
+(page-share-nfa) exec "child-text"
+(page-share-nfa) exec "child-text"
+(page-share-nfa) exec "child-text"
+(page-share-nfa) exec "child-text"
+(page-share-nfa) exec "child-text"
+(page-share-nfa) exec "child-text"
+(page-share-nfa) wait for child 0
+(page-share-nfa) wait for child 1
+(page-share-nfa) wait for child 2
+(page-share-nfa) wait for child 3
+(page-share-nfa) wait for child 4
+(page-share-nfa) wait for child 5
+(page-share-nfa) wait for child 6
+(page-share-nfa) wait for child 7
+(page-share-nfa) end
+EOF
+
+# With fault-around off, the first child reads its text from the
+# file and the others join the frames it left, still shared.
+my (@output) = read_text_file ("$test.output");
+my ($minor, $major) = map (/^Faults: (\d+) minor, (\d+) major$/, @output);
+fail "missing fault statistics in output\n" if !defined $major;
+fail "no minor faults counted\n" if $minor <= 0;
+fail "no major faults counted\n" if $major <= 0;
+my ($shared) = map (/(\d+) shared text pages/, @output);
+fail "missing paging statistics in output\n" if !defined $shared;
+fail "no text pages were shared\n" if $shared <= 0;
+pass;
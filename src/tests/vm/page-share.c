@@ -0,0 +1,25 @@
+/* Runs 8 child-text processes at once.  Their read-only pages
+   come from the same executable, so the kernel may let them share
+   frames; each child checks that it sees the right contents.  Run
+   as page-share-nfa, the kernel maps no pages around a fault, to
+   compare the fault counts. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CHILD_CNT 8
+
+void
+test_main (void)
+{
+  pid_t children[CHILD_CNT];
+  int i;
+
+  for (i = 0; i < CHILD_CNT; i++) 
+    CHECK ((children[i] = exec ("child-text")) != -1,
+           "exec \"child-text\"");
+
+  for (i = 0; i < CHILD_CNT; i++) 
+    CHECK (wait (children[i]) == 0x42, "wait for child %d", i);
+}
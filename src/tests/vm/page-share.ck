@@ -0,0 +1,32 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-share) begin
+(page-share) exec "child-text"
+(page-share) exec "child-text"
+(page-share) exec "child-text"
+(page-share) exec "child-text"
+(page-share) exec "child-text"
+(page-share) exec "child-text"
+(page-share) exec "child-text"
+(page-share) exec "child-text"
+(page-share) wait for child 0
+(page-share) wait for child 1
+(page-share) wait for child 2
+(page-share) wait for child 3
+(page-share) wait for child 4
+(page-share) wait for child 5
+(page-share) wait for child 6
+(page-share) wait for child 7
+(page-share) end
+EOF
+
+# The children must have run from the same frames.
+my ($shared) = map (/(\d+) shared text pages/, read_text_file ("$test.output"));
+fail "missing paging statistics in output\n" if !defined $shared;
+fail "no text pages were shared\n" if $shared <= 0;
+pass;
@@ -0,0 +1,44 @@
+/* Reads every page of a 1 MB uninitialized array, which should
+   all be zeros, then writes every other page, from user code and
+   through read(), and checks that the pages in between are still
+   zeros. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (1024 * 1024)
+#define PAGE 4096
+
+static char buf[SIZE];
+
+void
+test_main (void)
+{
+  int handle;
+  size_t i;
+
+  for (i = 0; i < SIZE; i++)
+    if (buf[i] != 0)
+      fail ("byte %zu is %d before any write", i, buf[i]);
+  msg ("read zeros");
+
+  for (i = 0; i < SIZE; i += 2 * PAGE)
+    buf[i] = 'u';
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (read (handle, buf + PAGE, 1) == 1, "read \"sample.txt\"");
+
+  for (i = 0; i < SIZE; i++)
+    {
+      char expected = 0;
+
+      if (i % (2 * PAGE) == 0)
+        expected = 'u';
+      else if (i == PAGE)
+        expected = '=';
+      if (buf[i] != expected)
+        fail ("byte %zu is %d, not %d", i, buf[i], expected);
+    }
+  msg ("written pages differ, others still zeros");
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(page-zero) begin
+(page-zero) read zeros
+(page-zero) open "sample.txt"
+(page-zero) read "sample.txt"
+(page-zero) written pages differ, others still zeros
+(page-zero) end
+page-zero: exit(0)
+EOF
+pass;
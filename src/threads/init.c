@@ -21,6 +21,8 @@
 #include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/pte.h"
+#include "threads/sched-trace.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
 #ifdef USERPROG
 #include "userprog/process.h"
@@ -33,6 +35,11 @@
 #endif
 #ifdef VM
 #include "devices/swap.h"
+#include "vm/frame.h"
+#include "vm/mmap.h"
+#include "vm/page.h"
+#include "vm/vma.h"
+#include "vm/zcache.h"
 #endif
 #ifdef FILESYS
 #include "devices/block.h"
@@ -120,6 +127,7 @@ main (void)
 
   /* Start thread scheduler and enable interrupts. */
   thread_start ();
+  palloc_start_zeroing ();
   serial_init_queue ();
   timer_calibrate ();
 
@@ -133,6 +141,10 @@ main (void)
 #ifdef VM
   /* Initialise the swap disk */  
   swap_init ();
+  frame_init ();
+  page_init ();
+  vma_init ();
+  mmap_init ();
 #endif
 
   printf ("Boot complete.\n");
@@ -258,12 +270,32 @@ parse_options (char **argv)
 #ifdef VM
       else if (!strcmp (name, "-swap"))
         swap_bdev_name = value;
+      else if (!strcmp (name, "-eager-load"))
+        page_eager_load = true;
+      else if (!strcmp (name, "-stack-limit"))
+        vma_stack_limit = (size_t) atoi (value) * 1024 * 1024;
+      else if (!strcmp (name, "-no-swap-cluster"))
+        page_swap_cluster = false;
+      else if (!strcmp (name, "-swap-cache"))
+        zcache_percent = atoi (value);
+      else if (!strcmp (name, "-fault-around"))
+        page_fault_around = atoi (value);
 #endif
 #endif
       else if (!strcmp (name, "-rs"))
         random_init (atoi (value));
       else if (!strcmp (name, "-mlfqs"))
         thread_mlfqs = true;
+      else if (!strcmp (name, "-donate-depth"))
+        lock_donation_depth = atoi (value);
+      else if (!strcmp (name, "-tickless"))
+        timer_tickless = true;
+      else if (!strcmp (name, "-sched-trace"))
+        sched_trace_on_shutdown = true;
+      else if (!strcmp (name, "-palloc-first-fit"))
+        palloc_first_fit = true;
+      else if (!strcmp (name, "-no-prezero"))
+        palloc_prezero = false;
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
@@ -383,10 +415,20 @@ usage (void)
           "  -scratch=BDEV      Use BDEV for scratch instead of default.\n"
 #ifdef VM
           "  -swap=BDEV         Use BDEV for swap instead of default.\n"
+          "  -eager-load        Read executables in at exec, not on demand.\n"
+          "  -stack-limit=MB    Let user stacks grow to MB megabytes (default 8).\n"
+          "  -no-swap-cluster   Swap pages one at a time, without read-ahead.\n"
+          "  -swap-cache=PCT    Grow compressed swap to PCT%% of user memory (default 20).\n"
+          "  -fault-around=N    Map up to N resident pages per fault (default 16).\n"
 #endif
 #endif
           "  -rs=SEED           Set random number seed to SEED.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+          "  -donate-depth=N    Follow at most N locks per priority donation.\n"
+          "  -tickless          Stop the timer tick while idle.\n"
+          "  -sched-trace       Dump the context-switch trace at shutdown.\n"
+          "  -palloc-first-fit  Allocate pages first fit, not buddy.\n"
+          "  -no-prezero        Don't zero free pages in the background.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
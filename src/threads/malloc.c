@@ -11,38 +11,75 @@
 
 /* A simple implementation of malloc().
 
-   The size of each request, in bytes, is rounded up to a power
-   of 2 and assigned to the "descriptor" that manages blocks of
-   that size.  The descriptor keeps a list of free blocks.  If
-   the free list is nonempty, one of its blocks is used to
-   satisfy the request.
-
-   Otherwise, a new page of memory, called an "arena", is
-   obtained from the page allocator (if none is available,
-   malloc() returns a null pointer).  The new arena is divided
-   into blocks, all of which are added to the descriptor's free
-   list.  Then we return one of the new blocks.
-
-   When we free a block, we add it to its descriptor's free list.
-   But if the arena that the block was in now has no in-use
-   blocks, we remove all of the arena's blocks from the free list
-   and give the arena back to the page allocator.
-
-   We can't handle blocks bigger than 2 kB using this scheme,
-   because they're too big to fit in a single page with a
-   descriptor.  We handle those by allocating contiguous pages
-   with the page allocator and sticking the allocation size at
-   the beginning of the allocated block's arena header. */
+   The size of each request, in bytes, is rounded up to the
+   nearest of a set of size classes that are spaced at most 50%
+   apart (8, 16, 24, 32, 48, 64, 96, ...), and assigned to the
+   "descriptor" that manages blocks of that size.  Blocks come
+   from pages of memory called "arenas" or slabs, each of which
+   holds blocks of a single size class and has a bitmap at its
+   beginning that tells which of its blocks are free.
+
+   Each descriptor keeps its arenas on three lists: partial
+   arenas, which have both free and used blocks, full arenas and
+   empty arenas.  A request is satisfied from the first partial
+   arena, using the first free block in its bitmap.  If there is
+   no partial arena, an empty one is used, and if there is none
+   of those either, a new arena is obtained from the page
+   allocator (if none is available, malloc() returns a null
+   pointer).
+
+   When we free a block, we mark it free in its arena's bitmap.
+   If that leaves the arena with no blocks in use, it goes on the
+   empty list, unless the descriptor already keeps MAX_EMPTY
+   empty arenas, in which case it is given back to the page
+   allocator.
+
+   Blocks bigger than the largest size class don't fit into a
+   single page with an arena header, or only one does.  We
+   handle those by allocating contiguous pages with the page
+   allocator and sticking the allocation size at the beginning
+   of the allocated block's arena header. */
+
+/* Size classes, in bytes.  Each is a multiple of 8, so blocks
+   are 8-byte aligned.  The last two fit 3 and 2 to an arena. */
+static const size_t class_sizes[] =
+  {
+    8, 16, 24, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024,
+    1336, 2000,
+  };
+#define CLASS_CNT (sizeof class_sizes / sizeof *class_sizes)
+
+/* Empty arenas kept by each descriptor. */
+#define MAX_EMPTY 2
 
 /* Descriptor. */
 struct desc
   {
     size_t block_size;          /* Size of each element in bytes. */
     size_t blocks_per_arena;    /* Number of blocks in an arena. */
-    struct list free_list;      /* List of free blocks. */
+    struct list partial;        /* Arenas with free and used blocks. */
+    struct list full;           /* Arenas with no free blocks. */
+    struct list empty;          /* Arenas with no used blocks. */
+    size_t empty_cnt;           /* Number of arenas in EMPTY. */
     struct lock lock;           /* Lock. */
+
+    /* Statistics. */
+    size_t arena_cnt;           /* Arenas held. */
+    size_t live_cnt;            /* Blocks in use. */
+    unsigned long long requested;   /* Bytes requested, ever. */
+    unsigned long long allocated;   /* Bytes handed out, ever. */
   };
 
+/* Element of an arena's free map. */
+typedef unsigned long map_elem;
+
+/* Number of bits in a map_elem. */
+#define MAP_ELEM_BITS (sizeof (map_elem) * 8)
+
+/* Number of map_elems in an arena's free map: enough for the
+   8-byte class. */
+#define MAP_ELEM_CNT 16
+
 /* Magic number for detecting arena corruption. */
 #define ARENA_MAGIC 0x9a548eed
 
@@ -52,36 +89,48 @@ struct arena
     unsigned magic;             /* Always set to ARENA_MAGIC. */
     struct desc *desc;          /* Owning descriptor, null for big block. */
     size_t free_cnt;            /* Free blocks; pages in big block. */
+    struct list_elem elem;      /* Element in one of DESC's lists. */
+    map_elem free_map[MAP_ELEM_CNT];    /* Bit set for each free block. */
   };
 
-/* Free block. */
-struct block 
-  {
-    struct list_elem free_elem; /* Free list element. */
-  };
+/* Offset of the first block in an arena. */
+#define ARENA_HEADER ROUND_UP (sizeof (struct arena), 8)
+
+/* Big block statistics. */
+static struct lock big_lock;    /* Protects the counters below. */
+static size_t big_live_cnt;     /* Big blocks in use. */
+static size_t big_page_cnt;     /* Pages in big blocks in use. */
 
 /* Our set of descriptors. */
-static struct desc descs[10];   /* Descriptors. */
+static struct desc descs[CLASS_CNT];    /* Descriptors. */
 static size_t desc_cnt;         /* Number of descriptors. */
 
-static struct arena *block_to_arena (struct block *);
-static struct block *arena_to_block (struct arena *, size_t idx);
+static struct arena *block_to_arena (void *);
+static void *arena_to_block (struct arena *, size_t idx);
+static struct arena *new_arena (struct desc *);
 
 /* Initializes the malloc() descriptors. */
 void
 malloc_init (void) 
 {
-  size_t block_size;
+  size_t i;
 
-  for (block_size = 16; block_size < PGSIZE / 2; block_size *= 2)
+  for (i = 0; i < CLASS_CNT; i++)
     {
       struct desc *d = &descs[desc_cnt++];
-      ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
-      d->block_size = block_size;
-      d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
-      list_init (&d->free_list);
+      d->block_size = class_sizes[i];
+      d->blocks_per_arena = (PGSIZE - ARENA_HEADER) / d->block_size;
+      ASSERT (d->blocks_per_arena >= 2);
+      ASSERT (d->blocks_per_arena <= MAP_ELEM_CNT * MAP_ELEM_BITS);
+      list_init (&d->partial);
+      list_init (&d->full);
+      list_init (&d->empty);
+      d->empty_cnt = 0;
       lock_init (&d->lock);
+      d->arena_cnt = d->live_cnt = 0;
+      d->requested = d->allocated = 0;
     }
+  lock_init (&big_lock);
 }
 
 /* Obtains and returns a new block of at least SIZE bytes.
@@ -90,8 +139,8 @@ void *
 malloc (size_t size) 
 {
   struct desc *d;
-  struct block *b;
   struct arena *a;
+  size_t i, idx;
 
   /* A null pointer satisfies a request for 0 bytes. */
   if (size == 0)
@@ -106,7 +155,7 @@ malloc (size_t size)
     {
       /* SIZE is too big for any descriptor.
          Allocate enough pages to hold SIZE plus an arena. */
-      size_t page_cnt = DIV_ROUND_UP (size + sizeof *a, PGSIZE);
+      size_t page_cnt = DIV_ROUND_UP (size + ARENA_HEADER, PGSIZE);
       a = palloc_get_multiple (0, page_cnt);
       if (a == NULL)
         return NULL;
@@ -116,41 +165,55 @@ malloc (size_t size)
       a->magic = ARENA_MAGIC;
       a->desc = NULL;
       a->free_cnt = page_cnt;
-      return a + 1;
+
+      lock_acquire (&big_lock);
+      big_live_cnt++;
+      big_page_cnt += page_cnt;
+      lock_release (&big_lock);
+      return (uint8_t *) a + ARENA_HEADER;
     }
 
   lock_acquire (&d->lock);
 
-  /* If the free list is empty, create a new arena. */
-  if (list_empty (&d->free_list))
+  /* Use a partial arena, an empty arena, or a new arena, in that
+     order of preference. */
+  if (!list_empty (&d->partial))
+    a = list_entry (list_front (&d->partial), struct arena, elem);
+  else 
     {
-      size_t i;
-
-      /* Allocate a page. */
-      a = palloc_get_page (0);
-      if (a == NULL) 
+      if (!list_empty (&d->empty)) 
         {
-          lock_release (&d->lock);
-          return NULL; 
+          a = list_entry (list_pop_front (&d->empty), struct arena, elem);
+          d->empty_cnt--;
         }
-
-      /* Initialize arena and add its blocks to the free list. */
-      a->magic = ARENA_MAGIC;
-      a->desc = d;
-      a->free_cnt = d->blocks_per_arena;
-      for (i = 0; i < d->blocks_per_arena; i++) 
+      else 
         {
-          struct block *b = arena_to_block (a, i);
-          list_push_back (&d->free_list, &b->free_elem);
+          a = new_arena (d);
+          if (a == NULL) 
+            {
+              lock_release (&d->lock);
+              return NULL; 
+            }
         }
+      list_push_front (&d->partial, &a->elem);
     }
 
-  /* Get a block from free list and return it. */
-  b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
-  a = block_to_arena (b);
-  a->free_cnt--;
+  /* Take the first free block in the arena. */
+  for (i = 0; a->free_map[i] == 0; i++)
+    ASSERT (i + 1 < MAP_ELEM_CNT);
+  idx = i * MAP_ELEM_BITS + __builtin_ctzl (a->free_map[i]);
+  a->free_map[i] &= ~((map_elem) 1 << (idx % MAP_ELEM_BITS));
+  if (--a->free_cnt == 0) 
+    {
+      list_remove (&a->elem);
+      list_push_front (&d->full, &a->elem);
+    }
+
+  d->live_cnt++;
+  d->requested += size;
+  d->allocated += d->block_size;
   lock_release (&d->lock);
-  return b;
+  return arena_to_block (a, idx);
 }
 
 /* Allocates and return A times B bytes initialized to zeroes.
@@ -178,8 +241,7 @@ calloc (size_t a, size_t b)
 static size_t
 block_size (void *block) 
 {
-  struct block *b = block;
-  struct arena *a = block_to_arena (b);
+  struct arena *a = block_to_arena (block);
   struct desc *d = a->desc;
 
   return d != NULL ? d->block_size : PGSIZE * a->free_cnt - pg_ofs (block);
@@ -220,36 +282,47 @@ free (void *p)
 {
   if (p != NULL)
     {
-      struct block *b = p;
-      struct arena *a = block_to_arena (b);
+      struct arena *a = block_to_arena (p);
       struct desc *d = a->desc;
       
       if (d != NULL) 
         {
           /* It's a normal block.  We handle it here. */
+          size_t idx = (pg_ofs (p) - ARENA_HEADER) / d->block_size;
+          map_elem mask = (map_elem) 1 << (idx % MAP_ELEM_BITS);
 
 #ifndef NDEBUG
           /* Clear the block to help detect use-after-free bugs. */
-          memset (b, 0xcc, d->block_size);
+          memset (p, 0xcc, d->block_size);
 #endif
   
           lock_acquire (&d->lock);
 
-          /* Add block to free list. */
-          list_push_front (&d->free_list, &b->free_elem);
+          /* Mark block free. */
+          ASSERT ((a->free_map[idx / MAP_ELEM_BITS] & mask) == 0);
+          a->free_map[idx / MAP_ELEM_BITS] |= mask;
+          d->live_cnt--;
 
-          /* If the arena is now entirely unused, free it. */
-          if (++a->free_cnt >= d->blocks_per_arena) 
+          /* Move the arena to the list that now fits it. */
+          if (a->free_cnt++ == 0) 
+            {
+              list_remove (&a->elem);
+              list_push_front (&d->partial, &a->elem);
+            }
+          if (a->free_cnt >= d->blocks_per_arena) 
             {
-              size_t i;
-
               ASSERT (a->free_cnt == d->blocks_per_arena);
-              for (i = 0; i < d->blocks_per_arena; i++) 
+              list_remove (&a->elem);
+              if (d->empty_cnt < MAX_EMPTY) 
+                {
+                  list_push_front (&d->empty, &a->elem);
+                  d->empty_cnt++;
+                }
+              else 
                 {
-                  struct block *b = arena_to_block (a, i);
-                  list_remove (&b->free_elem);
+                  d->arena_cnt--;
+                  palloc_free_page (a);
                 }
-              palloc_free_page (a);
             }
 
           lock_release (&d->lock);
@@ -257,15 +330,67 @@ free (void *p)
       else
         {
           /* It's a big block.  Free its pages. */
+          lock_acquire (&big_lock);
+          big_live_cnt--;
+          big_page_cnt -= a->free_cnt;
+          lock_release (&big_lock);
           palloc_free_multiple (a, a->free_cnt);
           return;
         }
     }
 }
 
+/* Prints statistics for each size class that has been used:
+   blocks in use, arenas held, and the share of the bytes handed
+   out so far that went to rounding requests up to the class
+   size. */
+void
+malloc_print_stats (void) 
+{
+  struct desc *d;
+
+  for (d = descs; d < descs + desc_cnt; d++)
+    if (d->allocated > 0)
+      printf ("Malloc: %zu-byte blocks: %zu live, %zu arenas (%zu empty), "
+              "%llu%% internal fragmentation\n",
+              d->block_size, d->live_cnt, d->arena_cnt, d->empty_cnt,
+              (d->allocated - d->requested) * 100 / d->allocated);
+  printf ("Malloc: big blocks: %zu live, %zu pages\n",
+          big_live_cnt, big_page_cnt);
+}
+
+/* Obtains a page from the page allocator and makes it into an
+   arena for D, with all of its blocks free.  Returns a null
+   pointer if no page is available. */
+static struct arena *
+new_arena (struct desc *d) 
+{
+  struct arena *a = palloc_get_page (0);
+  size_t i;
+
+  if (a == NULL)
+    return NULL;
+
+  a->magic = ARENA_MAGIC;
+  a->desc = d;
+  a->free_cnt = d->blocks_per_arena;
+  for (i = 0; i < MAP_ELEM_CNT; i++) 
+    {
+      size_t first = i * MAP_ELEM_BITS;
+      if (first + MAP_ELEM_BITS <= d->blocks_per_arena)
+        a->free_map[i] = (map_elem) -1;
+      else if (first < d->blocks_per_arena)
+        a->free_map[i] = ((map_elem) 1 << (d->blocks_per_arena - first)) - 1;
+      else
+        a->free_map[i] = 0;
+    }
+  d->arena_cnt++;
+  return a;
+}
+
 /* Returns the arena that block B is inside. */
 static struct arena *
-block_to_arena (struct block *b)
+block_to_arena (void *b)
 {
   struct arena *a = pg_round_down (b);
 
@@ -275,20 +400,18 @@ block_to_arena (struct block *b)
 
   /* Check that the block is properly aligned for the arena. */
   ASSERT (a->desc == NULL
-          || (pg_ofs (b) - sizeof *a) % a->desc->block_size == 0);
-  ASSERT (a->desc != NULL || pg_ofs (b) == sizeof *a);
+          || (pg_ofs (b) - ARENA_HEADER) % a->desc->block_size == 0);
+  ASSERT (a->desc != NULL || pg_ofs (b) == ARENA_HEADER);
 
   return a;
 }
 
-/* Returns the (IDX - 1)'th block within arena A. */
-static struct block *
+/* Returns the IDX'th block within arena A. */
+static void *
 arena_to_block (struct arena *a, size_t idx) 
 {
   ASSERT (a != NULL);
   ASSERT (a->magic == ARENA_MAGIC);
   ASSERT (idx < a->desc->blocks_per_arena);
-  return (struct block *) ((uint8_t *) a
-                           + sizeof *a
-                           + idx * a->desc->block_size);
+  return (uint8_t *) a + ARENA_HEADER + idx * a->desc->block_size;
 }
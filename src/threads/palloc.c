@@ -7,8 +7,10 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/loader.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 #include "threads/vaddr.h"
 
 /* Page allocator.  Hands out memory in page-size (or
@@ -23,22 +25,103 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Each pool is managed by a binary buddy allocator.  A free
+   block of 2**K pages starts at a page index that is a multiple
+   of 2**K and sits on the free list for order K.  An allocation
+   takes a block from the smallest nonempty order that fits,
+   splitting it in halves as needed, and gives back the pages
+   past the end of the request.  Freeing a range breaks it into
+   aligned blocks, each of which is merged with its buddy for as
+   long as the buddy is also free.  Both take O(log n) time.
+   Free list elements live in the free pages themselves, and
+   the buddy state is protected by turning interrupts off,
+   because pages may be freed during a context switch.
+
+   The "-palloc-first-fit" kernel option selects the original
+   first-fit scan of the pool's bitmap instead, for comparison.
+   Under the buddy allocator the bitmap is kept only in debug
+   builds, to cross-check that no page is handed out twice or
+   freed twice.
+
+   Each pool also keeps up to ZERO_POOL_MAX free pages that have
+   already been zeroed, so that most single-page PAL_ZERO
+   requests don't have to clear a page on the spot.  A kernel
+   thread of the lowest priority refills these pools from the
+   free pages, so the zeroing happens while the CPU would
+   otherwise be idle.  When a request can't be met any other
+   way, the pre-zeroed pages are given back first. */
+
+/* Number of block orders: blocks of 1, 2, 4, ..., 2**19 pages. */
+#define BUDDY_ORDERS 20
+
+/* Most pre-zeroed pages kept by a pool. */
+#define ZERO_POOL_MAX 16
+
+/* The zeroing thread refills a pool that falls below this. */
+#define ZERO_POOL_LOW 8
+
+/* A free block, at the start of its first page. */
+struct buddy_block
+  {
+    struct list_elem elem;              /* Element in free list. */
+  };
 
 /* A memory pool. */
 struct pool
   {
-    struct lock lock;                   /* Mutual exclusion. */
+    const char *name;                   /* Name, for statistics. */
+    struct lock lock;                   /* Mutual exclusion, first fit. */
     struct bitmap *used_map;            /* Bitmap of free pages. */
     uint8_t *base;                      /* Base of pool. */
+    size_t page_cnt;                    /* Number of pages in pool. */
+
+    /* Buddy allocator. */
+    uint8_t *free_order;                /* Per page: 1 + order of the free
+                                           block starting there, or 0. */
+    struct list free_lists[BUDDY_ORDERS]; /* Free blocks by order. */
+    size_t free_cnt;                    /* Number of free pages. */
+    unsigned long long split_cnt;       /* Blocks split. */
+    unsigned long long merge_cnt;       /* Blocks merged with a buddy. */
+
+    /* Pre-zeroed pages. */
+    struct list zero_list;              /* Zeroed pages, in use by us. */
+    size_t zero_cnt;                    /* Number of pages in zero_list. */
+    unsigned long long zero_hit_cnt;    /* PAL_ZERO pages from zero_list. */
+    unsigned long long zero_miss_cnt;   /* PAL_ZERO pages zeroed on demand. */
   };
 
 /* Two pools: one for kernel data, one for user pages. */
 static struct pool kernel_pool, user_pool;
 
+/* If true, use first fit over the pool bitmaps instead of the
+   buddy allocator.  Controlled by kernel command-line option
+   "-palloc-first-fit". */
+bool palloc_first_fit;
+
+/* If false, don't keep pre-zeroed pages.  Controlled by kernel
+   command-line option "-no-prezero". */
+bool palloc_prezero = true;
+
+/* Zeroing thread. */
+static struct semaphore zero_sema;      /* Upped to wake the thread. */
+static bool zeroer_idle;                /* Is it waiting on zero_sema? */
+
 static void init_pool (struct pool *, void *base, size_t page_cnt,
                        const char *name);
 static bool page_from_pool (const struct pool *, void *page);
+static void free_range (struct pool *, size_t page_idx, size_t page_cnt);
+static size_t buddy_alloc (struct pool *, size_t page_cnt);
+static void buddy_free (struct pool *, size_t page_idx, size_t page_cnt);
+static size_t take_pages (struct pool *, size_t page_cnt);
+static void release_pages (struct pool *, size_t page_idx, size_t page_cnt);
+static void *take_zeroed_page (struct pool *);
+static void drain_zero_pool (struct pool *);
+static void wake_zeroer (void);
+static thread_func zero_thread NO_RETURN;
+static size_t largest_free (struct pool *);
+static void print_pool_stats (struct pool *);
 
 /* Initializes the page allocator.  At most USER_PAGE_LIMIT
    pages are put into the user pool. */
@@ -59,6 +142,17 @@ palloc_init (size_t user_page_limit)
   init_pool (&kernel_pool, free_start, kernel_pages, "kernel pool");
   init_pool (&user_pool, free_start + kernel_pages * PGSIZE,
              user_pages, "user pool");
+  sema_init (&zero_sema, 0);
+}
+
+/* Starts the thread that keeps the pools of pre-zeroed pages
+   filled, unless "-no-prezero" was given.  Must be called after
+   thread_start(). */
+void
+palloc_start_zeroing (void) 
+{
+  if (palloc_prezero)
+    thread_create ("zeroer", PRI_MIN, zero_thread, NULL);
 }
 
 /* Obtains and returns a group of PAGE_CNT contiguous free pages.
@@ -77,9 +171,20 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
   if (page_cnt == 0)
     return NULL;
 
-  lock_acquire (&pool->lock);
-  page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-  lock_release (&pool->lock);
+  if ((flags & PAL_ZERO) && page_cnt == 1) 
+    {
+      pages = take_zeroed_page (pool);
+      if (pages != NULL)
+        return pages;
+    }
+
+  page_idx = take_pages (pool, page_cnt);
+  if (page_idx == BITMAP_ERROR && pool->zero_cnt > 0) 
+    {
+      /* Give the pre-zeroed pages back and try again. */
+      drain_zero_pool (pool);
+      page_idx = take_pages (pool, page_cnt);
+    }
 
   if (page_idx != BITMAP_ERROR)
     pages = pool->base + PGSIZE * page_idx;
@@ -88,8 +193,12 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
 
   if (pages != NULL) 
     {
-      if (flags & PAL_ZERO)
-        memset (pages, 0, PGSIZE * page_cnt);
+      if (flags & PAL_ZERO) 
+        {
+          memset (pages, 0, PGSIZE * page_cnt);
+          if (page_cnt == 1)
+            pool->zero_miss_cnt++;
+        }
     }
   else 
     {
@@ -137,8 +246,7 @@ palloc_free_multiple (void *pages, size_t page_cnt)
   memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
 
-  ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
-  bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+  release_pages (pool, page_idx, page_cnt);
 }
 
 /* Frees the page at PAGE. */
@@ -153,10 +261,13 @@ palloc_free_page (void *page)
 static void
 init_pool (struct pool *p, void *base, size_t page_cnt, const char *name) 
 {
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
-     and subtract it from the pool's size. */
-  size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (page_cnt), PGSIZE);
+  /* We'll put the pool's used_map and free_order map at its
+     base.  Calculate the space needed for them and subtract it
+     from the pool's size. */
+  size_t bm_size = bitmap_buf_size (page_cnt);
+  size_t bm_pages = DIV_ROUND_UP (bm_size + page_cnt, PGSIZE);
+  int order;
+
   if (bm_pages > page_cnt)
     PANIC ("Not enough memory in %s for bitmap.", name);
   page_cnt -= bm_pages;
@@ -164,9 +275,24 @@ init_pool (struct pool *p, void *base, size_t page_cnt, const char *name)
   printf ("%zu pages available in %s.\n", page_cnt, name);
 
   /* Initialize the pool. */
+  p->name = name;
   lock_init (&p->lock);
-  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_pages * PGSIZE);
+  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_size);
   p->base = base + bm_pages * PGSIZE;
+  p->page_cnt = page_cnt;
+
+  /* Put all of the pool's pages on the buddy free lists. */
+  p->free_order = (uint8_t *) base + bm_size;
+  memset (p->free_order, 0, page_cnt);
+  for (order = 0; order < BUDDY_ORDERS; order++)
+    list_init (&p->free_lists[order]);
+  p->free_cnt = 0;
+  p->split_cnt = p->merge_cnt = 0;
+  list_init (&p->zero_list);
+  p->zero_cnt = 0;
+  p->zero_hit_cnt = p->zero_miss_cnt = 0;
+  if (!palloc_first_fit)
+    free_range (p, 0, page_cnt);
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -180,3 +306,340 @@ page_from_pool (const struct pool *pool, void *page)
 
   return page_no >= start_page && page_no < end_page;
 }
+
+/* Allocates PAGE_CNT contiguous pages from POOL and returns the
+   index of the first one, or BITMAP_ERROR if there are not
+   enough free pages. */
+static size_t
+take_pages (struct pool *pool, size_t page_cnt) 
+{
+  size_t page_idx;
+
+  if (!palloc_first_fit)
+    return buddy_alloc (pool, page_cnt);
+
+  lock_acquire (&pool->lock);
+  page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
+  lock_release (&pool->lock);
+  return page_idx;
+}
+
+/* Frees the PAGE_CNT pages at PAGE_IDX in POOL. */
+static void
+release_pages (struct pool *pool, size_t page_idx, size_t page_cnt) 
+{
+  if (palloc_first_fit) 
+    {
+      ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
+      bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+    }
+  else
+    buddy_free (pool, page_idx, page_cnt);
+}
+
+/* Takes a page from POOL's pre-zeroed pages and returns it, or
+   returns a null pointer if there is none. */
+static void *
+take_zeroed_page (struct pool *pool) 
+{
+  enum intr_level old_level;
+  struct list_elem *e = NULL;
+
+  old_level = intr_disable ();
+  if (!list_empty (&pool->zero_list)) 
+    {
+      e = list_pop_front (&pool->zero_list);
+      pool->zero_cnt--;
+      pool->zero_hit_cnt++;
+    }
+  intr_set_level (old_level);
+
+  if (pool->zero_cnt < ZERO_POOL_LOW)
+    wake_zeroer ();
+  if (e == NULL)
+    return NULL;
+
+  /* The list element is the only part of the page that isn't
+     zero. */
+  memset (e, 0, sizeof *e);
+  return e;
+}
+
+/* Gives all of POOL's pre-zeroed pages back to its free pages. */
+static void
+drain_zero_pool (struct pool *pool) 
+{
+  for (;;) 
+    {
+      enum intr_level old_level = intr_disable ();
+      struct list_elem *e = NULL;
+
+      if (!list_empty (&pool->zero_list)) 
+        {
+          e = list_pop_front (&pool->zero_list);
+          pool->zero_cnt--;
+        }
+      intr_set_level (old_level);
+
+      if (e == NULL)
+        break;
+      release_pages (pool, pg_no (e) - pg_no (pool->base), 1);
+    }
+}
+
+/* Zeroes one free page of POOL and adds it to POOL's pre-zeroed
+   pages, if POOL has room for more.  Returns true if
+   successful, false if POOL is full or out of free pages. */
+static bool
+refill_zero_pool (struct pool *pool) 
+{
+  enum intr_level old_level;
+  size_t page_idx;
+  uint8_t *page;
+
+  if (pool->zero_cnt >= ZERO_POOL_MAX)
+    return false;
+  page_idx = take_pages (pool, 1);
+  if (page_idx == BITMAP_ERROR)
+    return false;
+
+  page = pool->base + PGSIZE * page_idx;
+  memset (page, 0, PGSIZE);
+
+  old_level = intr_disable ();
+  list_push_back (&pool->zero_list, (struct list_elem *) page);
+  pool->zero_cnt++;
+  intr_set_level (old_level);
+  return true;
+}
+
+/* Wakes up the zeroing thread, if it is waiting for work.
+   This is not done when pages are freed, because that can happen
+   in the middle of a context switch. */
+static void
+wake_zeroer (void) 
+{
+  enum intr_level old_level = intr_disable ();
+  if (zeroer_idle) 
+    {
+      zeroer_idle = false;
+      sema_up (&zero_sema);
+    }
+  intr_set_level (old_level);
+}
+
+/* Zeroing thread.  Keeps the pools of pre-zeroed pages filled,
+   one page at a time, and waits when both are full or their
+   free pages have run out. */
+static void
+zero_thread (void *aux UNUSED) 
+{
+  if (thread_mlfqs)
+    thread_set_nice (NICE_MAX);
+
+  for (;;) 
+    {
+      bool refilled = refill_zero_pool (&kernel_pool);
+      refilled = refill_zero_pool (&user_pool) || refilled;
+      if (!refilled) 
+        {
+          enum intr_level old_level = intr_disable ();
+          zeroer_idle = true;
+          sema_down (&zero_sema);
+          intr_set_level (old_level);
+        }
+    }
+}
+
+/* Returns the buddy block at page PAGE_IDX in POOL. */
+static struct buddy_block *
+block_at (const struct pool *pool, size_t page_idx) 
+{
+  return (struct buddy_block *) (pool->base + PGSIZE * page_idx);
+}
+
+/* Puts the free block of 2**ORDER pages at PAGE_IDX in POOL on
+   its free list, without merging. */
+static void
+push_block (struct pool *pool, size_t page_idx, int order) 
+{
+  pool->free_order[page_idx] = order + 1;
+  list_push_front (&pool->free_lists[order],
+                   &block_at (pool, page_idx)->elem);
+}
+
+/* Frees the block of 2**ORDER pages at PAGE_IDX in POOL,
+   merging it with its buddy for as long as the buddy is free. */
+static void
+free_block (struct pool *pool, size_t page_idx, int order) 
+{
+  while (order + 1 < BUDDY_ORDERS) 
+    {
+      size_t size = (size_t) 1 << order;
+      size_t buddy_idx = page_idx ^ size;
+
+      if (buddy_idx + size > pool->page_cnt
+          || pool->free_order[buddy_idx] != order + 1)
+        break;
+
+      pool->free_order[buddy_idx] = 0;
+      list_remove (&block_at (pool, buddy_idx)->elem);
+      page_idx &= ~size;
+      order++;
+      pool->merge_cnt++;
+    }
+  push_block (pool, page_idx, order);
+}
+
+/* Returns the PAGE_CNT pages at PAGE_IDX in POOL to the free
+   lists, as the largest aligned blocks that cover them.
+   Interrupts must be off. */
+static void
+free_range (struct pool *pool, size_t page_idx, size_t page_cnt) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  pool->free_cnt += page_cnt;
+  while (page_cnt > 0) 
+    {
+      int order = 0;
+
+      while (order + 1 < BUDDY_ORDERS
+             && page_idx % ((size_t) 2 << order) == 0
+             && ((size_t) 2 << order) <= page_cnt)
+        order++;
+      free_block (pool, page_idx, order);
+      page_idx += (size_t) 1 << order;
+      page_cnt -= (size_t) 1 << order;
+    }
+}
+
+/* Allocates PAGE_CNT contiguous pages from POOL and returns the
+   index of the first one, or BITMAP_ERROR if no free block is
+   large enough. */
+static size_t
+buddy_alloc (struct pool *pool, size_t page_cnt) 
+{
+  enum intr_level old_level;
+  struct buddy_block *b;
+  size_t page_idx;
+  int order, want;
+
+  for (want = 0; ((size_t) 1 << want) < page_cnt; want++)
+    if (want + 1 >= BUDDY_ORDERS)
+      return BITMAP_ERROR;
+
+  old_level = intr_disable ();
+  for (order = want; order < BUDDY_ORDERS; order++)
+    if (!list_empty (&pool->free_lists[order]))
+      break;
+  if (order >= BUDDY_ORDERS) 
+    {
+      intr_set_level (old_level);
+      return BITMAP_ERROR;
+    }
+
+  b = list_entry (list_pop_front (&pool->free_lists[order]),
+                  struct buddy_block, elem);
+  page_idx = ((uint8_t *) b - pool->base) / PGSIZE;
+  pool->free_order[page_idx] = 0;
+  pool->free_cnt -= (size_t) 1 << want;
+
+  /* Split off upper halves until the block is the right order. */
+  while (order > want) 
+    {
+      order--;
+      push_block (pool, page_idx + ((size_t) 1 << order), order);
+      pool->split_cnt++;
+    }
+
+  /* Give back the pages past the end of the request. */
+  if (((size_t) 1 << want) > page_cnt)
+    free_range (pool, page_idx + page_cnt, ((size_t) 1 << want) - page_cnt);
+
+#ifndef NDEBUG
+  ASSERT (bitmap_none (pool->used_map, page_idx, page_cnt));
+  bitmap_set_multiple (pool->used_map, page_idx, page_cnt, true);
+#endif
+  intr_set_level (old_level);
+
+  return page_idx;
+}
+
+/* Frees the PAGE_CNT pages at PAGE_IDX in POOL. */
+static void
+buddy_free (struct pool *pool, size_t page_idx, size_t page_cnt) 
+{
+  enum intr_level old_level = intr_disable ();
+
+#ifndef NDEBUG
+  ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
+  bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+#endif
+  free_range (pool, page_idx, page_cnt);
+  intr_set_level (old_level);
+}
+
+/* Returns the number of pages in the largest block of free
+   pages in POOL. */
+static size_t
+largest_free (struct pool *pool) 
+{
+  if (palloc_first_fit) 
+    {
+      size_t largest = 0, run = 0, i;
+
+      for (i = 0; i < pool->page_cnt; i++)
+        if (!bitmap_test (pool->used_map, i))
+          {
+            if (++run > largest)
+              largest = run;
+          }
+        else
+          run = 0;
+      return largest;
+    }
+  else 
+    {
+      int order;
+
+      for (order = BUDDY_ORDERS - 1; order >= 0; order--)
+        if (!list_empty (&pool->free_lists[order]))
+          return (size_t) 1 << order;
+      return 0;
+    }
+}
+
+/* Returns the number of pages in the user pool. */
+size_t
+palloc_user_pages (void) 
+{
+  return user_pool.page_cnt;
+}
+
+/* Prints statistics for POOL. */
+static void
+print_pool_stats (struct pool *pool) 
+{
+  size_t free_cnt = (palloc_first_fit
+                     ? bitmap_count (pool->used_map, 0, pool->page_cnt, false)
+                     : pool->free_cnt);
+
+  printf ("Palloc: %s: %zu of %zu pages free, largest free block %zu pages",
+          pool->name, free_cnt, pool->page_cnt, largest_free (pool));
+  if (!palloc_first_fit)
+    printf (", %llu splits, %llu merges", pool->split_cnt, pool->merge_cnt);
+  printf ("\n");
+  if (palloc_prezero)
+    printf ("Palloc: %s: %zu pre-zeroed pages, %llu PAL_ZERO hits, "
+            "%llu misses\n", pool->name, pool->zero_cnt,
+            pool->zero_hit_cnt, pool->zero_miss_cnt);
+}
+
+/* Prints page allocator statistics. */
+void
+palloc_print_stats (void) 
+{
+  print_pool_stats (&kernel_pool);
+  print_pool_stats (&user_pool);
+}
@@ -1,6 +1,7 @@
 #ifndef THREADS_PALLOC_H
 #define THREADS_PALLOC_H
 
+#include <stdbool.h>
 #include <stddef.h>
 
 /* How to allocate pages. */
@@ -11,10 +12,19 @@ enum palloc_flags
     PAL_USER = 004              /* User page. */
   };
 
+/* Use first fit instead of the buddy allocator? */
+extern bool palloc_first_fit;
+
+/* Keep pre-zeroed pages for PAL_ZERO requests? */
+extern bool palloc_prezero;
+
 void palloc_init (size_t user_page_limit);
+void palloc_start_zeroing (void);
 void *palloc_get_page (enum palloc_flags);
 void *palloc_get_multiple (enum palloc_flags, size_t page_cnt);
 void palloc_free_page (void *);
 void palloc_free_multiple (void *, size_t page_cnt);
+size_t palloc_user_pages (void);
+void palloc_print_stats (void);
 
 #endif /* threads/palloc.h */
@@ -0,0 +1,78 @@
+#include "threads/sched-trace.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+
+/* Scheduler trace.
+
+   Every context switch is recorded as an event in a fixed-size
+   ring buffer, overwriting the oldest event once the buffer is
+   full, so that the most recent scheduling history is always
+   available for diagnosing latency spikes.  Events are recorded
+   by thread_schedule_tail() with interrupts off, and there is
+   only one CPU, so the ring needs no lock: a writer is never
+   interrupted by another writer.
+
+   With the -sched-trace option, the buffer is dumped at
+   shutdown as CSV, one event per line, for utils/sched-trace to
+   turn into latency histograms. */
+
+/* Number of events kept.  Must be a power of 2. */
+#define SCHED_TRACE_SIZE 1024
+
+/* A context switch. */
+struct sched_event 
+  {
+    uint64_t tsc;               /* Time-stamp counter at the switch. */
+    tid_t prev;                 /* Thread that gave up the CPU. */
+    tid_t next;                 /* Thread that got the CPU. */
+    enum sched_reason reason;   /* Why PREV gave up the CPU. */
+  };
+
+static struct sched_event events[SCHED_TRACE_SIZE];
+static uint32_t event_cnt;      /* Events ever recorded. */
+
+bool sched_trace_on_shutdown;
+
+/* Records a switch from thread PREV to thread NEXT for REASON.
+   Interrupts must be off. */
+void
+sched_trace_record (tid_t prev, tid_t next, enum sched_reason reason) 
+{
+  struct sched_event *e = &events[event_cnt++ & (SCHED_TRACE_SIZE - 1)];
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  e->tsc = timer_tsc ();
+  e->prev = prev;
+  e->next = next;
+  e->reason = reason;
+}
+
+/* Prints the recorded events, oldest first, if -sched-trace was
+   given. */
+void
+sched_trace_dump (void) 
+{
+  static const char reasons[] = "bype";
+  uint32_t first, last, i;
+
+  if (!sched_trace_on_shutdown)
+    return;
+
+  /* Printing may itself cause switches, so fix the range first. */
+  last = event_cnt;
+  first = last > SCHED_TRACE_SIZE ? last - SCHED_TRACE_SIZE : 0;
+  printf ("sched-trace: begin tsc_hz=%"PRIu64" events=%"PRIu32
+          " dropped=%"PRIu32"\n", timer_tsc_freq (), last - first, first);
+  for (i = first; i != last; i++) 
+    {
+      const struct sched_event *e = &events[i & (SCHED_TRACE_SIZE - 1)];
+      printf ("S,%"PRIu64",%d,%d,%c\n",
+              e->tsc, e->prev, e->next, reasons[e->reason]);
+    }
+  printf ("sched-trace: end\n");
+}
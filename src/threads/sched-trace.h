@@ -0,0 +1,22 @@
+#ifndef THREADS_SCHED_TRACE_H
+#define THREADS_SCHED_TRACE_H
+
+#include <stdbool.h>
+#include "threads/thread.h"
+
+/* Why a thread gave up the CPU. */
+enum sched_reason
+  {
+    SCHED_BLOCK,                /* Blocked, e.g. on a semaphore. */
+    SCHED_YIELD,                /* Yielded of its own accord. */
+    SCHED_PREEMPT,              /* Preempted by another thread. */
+    SCHED_EXIT                  /* Exited. */
+  };
+
+/* Dump the trace at shutdown?  Set by -sched-trace. */
+extern bool sched_trace_on_shutdown;
+
+void sched_trace_record (tid_t prev, tid_t next, enum sched_reason);
+void sched_trace_dump (void);
+
+#endif /* threads/sched-trace.h */
@@ -0,0 +1,170 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* Object caches.
+
+   A slab cache hands out objects of one fixed size, such as
+   thread pages or the bookkeeping structures of a process.
+   Freed objects go onto the cache's free list instead of back
+   to the page allocator, so that the next allocation is just a
+   list pop.  When the free list is empty, a page (a "slab") is
+   obtained from the page allocator and carved into as many
+   objects as fit.
+
+   A free object holds its free list element in its first
+   bytes, so an object has no header and is at least as big as
+   a list element.  An optional constructor initializes each
+   object as slab_alloc() hands it out.
+
+   Objects that fill a whole page are handed out as one page per
+   slab.  Up to PAGE_CACHE_MAX free pages are kept in the cache
+   and the rest go back to the page allocator.  The pages of
+   smaller objects stay with their cache, because an object's
+   page can be returned only once all of its objects are free.
+
+   The free lists are protected by turning interrupts off rather
+   than by a lock, because thread pages are freed in the middle
+   of a context switch, when a thread cannot block. */
+
+/* Free pages kept by a cache of page-sized objects. */
+#define PAGE_CACHE_MAX 32
+
+/* Free object. */
+struct free_obj 
+  {
+    struct list_elem elem;      /* Free list element. */
+  };
+
+/* All caches, for statistics. */
+static struct list all_caches = LIST_INITIALIZER (all_caches);
+
+/* Initializes cache C to hand out objects of OBJ_SIZE bytes,
+   which may be at most a page, running CTOR, if it is nonnull,
+   on each object that is handed out.  NAME is used in
+   statistics. */
+void
+slab_cache_init (struct slab_cache *c, const char *name, size_t obj_size,
+                 slab_ctor_func *ctor) 
+{
+  ASSERT (c != NULL);
+  ASSERT (obj_size > 0 && obj_size <= PGSIZE);
+
+  if (obj_size < sizeof (struct free_obj))
+    obj_size = sizeof (struct free_obj);
+  obj_size = ROUND_UP (obj_size, sizeof (void *));
+
+  c->name = name;
+  c->obj_size = obj_size;
+  c->objs_per_slab = PGSIZE / obj_size;
+  c->ctor = ctor;
+  list_init (&c->free_list);
+  c->free_cnt = 0;
+  c->slab_cnt = 0;
+  c->alloc_cnt = 0;
+  c->refill_cnt = 0;
+  list_push_back (&all_caches, &c->elem);
+}
+
+/* Obtains and returns an object from cache C, or a null pointer
+   if memory is not available.  The object's contents are
+   undefined unless C has a constructor. */
+void *
+slab_alloc (struct slab_cache *c) 
+{
+  enum intr_level old_level;
+  void *obj = NULL;
+
+  ASSERT (!intr_context ());
+
+  old_level = intr_disable ();
+  c->alloc_cnt++;
+  if (!list_empty (&c->free_list)) 
+    {
+      obj = list_entry (list_pop_front (&c->free_list),
+                        struct free_obj, elem);
+      c->free_cnt--;
+    }
+  intr_set_level (old_level);
+
+  if (obj == NULL) 
+    {
+      /* Carve a new slab.  Keep the first object, put the others
+         on the free list. */
+      uint8_t *slab = palloc_get_page (0);
+      size_t i;
+
+      if (slab == NULL)
+        return NULL;
+      obj = slab;
+
+      old_level = intr_disable ();
+      c->slab_cnt++;
+      c->refill_cnt++;
+      for (i = 1; i < c->objs_per_slab; i++) 
+        {
+          struct free_obj *f = (struct free_obj *) (slab + i * c->obj_size);
+          list_push_back (&c->free_list, &f->elem);
+          c->free_cnt++;
+        }
+      intr_set_level (old_level);
+    }
+
+  if (c->ctor != NULL)
+    c->ctor (obj);
+  return obj;
+}
+
+/* Returns OBJ, which must have been obtained from cache C, to
+   C.  May be called with interrupts off, but not from an
+   interrupt handler. */
+void
+slab_free (struct slab_cache *c, void *obj) 
+{
+  enum intr_level old_level;
+
+  if (obj == NULL)
+    return;
+  ASSERT (!intr_context ());
+
+#ifndef NDEBUG
+  /* Clear the object to help detect use-after-free bugs. */
+  memset (obj, 0xcc, c->obj_size);
+#endif
+
+  old_level = intr_disable ();
+  if (c->objs_per_slab == 1 && c->free_cnt >= PAGE_CACHE_MAX) 
+    {
+      c->slab_cnt--;
+      palloc_free_page (obj);
+    }
+  else 
+    {
+      struct free_obj *f = obj;
+      list_push_front (&c->free_list, &f->elem);
+      c->free_cnt++;
+    }
+  intr_set_level (old_level);
+}
+
+/* Prints statistics for every cache. */
+void
+slab_print_stats (void) 
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&all_caches); e != list_end (&all_caches);
+       e = list_next (e)) 
+    {
+      struct slab_cache *c = list_entry (e, struct slab_cache, elem);
+      printf ("Slab: %s: %llu allocations, %llu refills, "
+              "%zu pages, %zu free objects\n",
+              c->name, c->alloc_cnt, c->refill_cnt, c->slab_cnt, c->free_cnt);
+    }
+}
@@ -0,0 +1,31 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <list.h>
+#include <stddef.h>
+
+/* Initializes object OBJ as it is handed out by slab_alloc(). */
+typedef void slab_ctor_func (void *obj);
+
+/* A cache of fixed-size kernel objects. */
+struct slab_cache 
+  {
+    const char *name;           /* Name, for statistics. */
+    size_t obj_size;            /* Size of each object in bytes. */
+    size_t objs_per_slab;       /* Objects carved out of each page. */
+    slab_ctor_func *ctor;       /* Optional constructor. */
+    struct list free_list;      /* Free objects. */
+    size_t free_cnt;            /* Number of objects in free_list. */
+    size_t slab_cnt;            /* Pages held by this cache. */
+    unsigned long long alloc_cnt;   /* Allocations. */
+    unsigned long long refill_cnt;  /* Allocations that took a new page. */
+    struct list_elem elem;      /* Element in list of all caches. */
+  };
+
+void slab_cache_init (struct slab_cache *, const char *name,
+                      size_t obj_size, slab_ctor_func *);
+void *slab_alloc (struct slab_cache *);
+void slab_free (struct slab_cache *, void *);
+void slab_print_stats (void);
+
+#endif /* threads/slab.h */
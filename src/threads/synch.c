@@ -32,6 +32,33 @@
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 
+/* See synch.h. */
+unsigned lock_donation_depth = LOCK_DONATION_DEPTH_DEFAULT;
+
+static void lock_donate (struct lock *, int priority);
+static void lock_grant (struct lock *, struct thread *);
+static heap_less_func sema_waiter_less;
+static heap_less_func cond_waiter_less;
+
+/* One semaphore in a condition variable's heap of waiters. */
+struct semaphore_elem 
+  {
+    struct heap_elem elem;              /* Heap element. */
+    struct semaphore semaphore;         /* This semaphore. */
+    struct condition *cond;             /* Condition, null once signaled. */
+    int priority;                       /* Priority of the waiter. */
+    unsigned seq;                       /* Arrival number. */
+  };
+
+/* Returns true if arrival number A is after arrival number B.
+   Correct across wraparound as long as the two are less than
+   2**31 arrivals apart. */
+static inline bool
+seq_after (unsigned a, unsigned b) 
+{
+  return (int) (a - b) > 0;
+}
+
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
    manipulating it:
@@ -47,7 +74,8 @@ sema_init (struct semaphore *sema, unsigned value)
   ASSERT (sema != NULL);
 
   sema->value = value;
-  list_init (&sema->waiters);
+  heap_init (&sema->waiters, sema_waiter_less, NULL);
+  sema->next_seq = 0;
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -68,7 +96,10 @@ sema_down (struct semaphore *sema)
   old_level = intr_disable ();
   while (sema->value == 0) 
     {
-      list_push_back (&sema->waiters, &thread_current ()->elem);
+      struct thread *cur = thread_current ();
+      cur->waiting_sema = sema;
+      cur->wait_seq = sema->next_seq++;
+      heap_push (&sema->waiters, &cur->waitelem);
       thread_block ();
     }
   sema->value--;
@@ -102,7 +133,9 @@ sema_try_down (struct semaphore *sema)
 }
 
 /* Up or "V" operation on a semaphore.  Increments SEMA's value
-   and wakes up one thread of those waiting for SEMA, if any.
+   and wakes up the highest-priority thread of those waiting for
+   SEMA, if any.  If the woken thread has a higher priority than
+   the running thread, the running thread is preempted.
 
    This function may be called from an interrupt handler. */
 void
@@ -113,11 +146,49 @@ sema_up (struct semaphore *sema)
   ASSERT (sema != NULL);
 
   old_level = intr_disable ();
-  if (!list_empty (&sema->waiters)) 
-    thread_unblock (list_entry (list_pop_front (&sema->waiters),
-                                struct thread, elem));
+  if (!heap_empty (&sema->waiters)) 
+    {
+      struct thread *t = heap_entry (heap_pop (&sema->waiters),
+                                     struct thread, waitelem);
+      t->waiting_sema = NULL;
+      thread_unblock (t);
+    }
   sema->value++;
   intr_set_level (old_level);
+  thread_yield_to_higher ();
+}
+
+/* Restores the order of the waiter heaps that blocked thread T
+   sleeps in, after T's priority has changed.  Interrupts must be
+   off. */
+void
+sema_requeue (struct thread *t) 
+{
+  struct semaphore_elem *waiter = t->cond_waiter;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (t->status == THREAD_BLOCKED && t->waiting_sema != NULL);
+
+  heap_update (&t->waiting_sema->waiters, &t->waitelem);
+  if (waiter != NULL && waiter->cond != NULL) 
+    {
+      waiter->priority = t->priority;
+      heap_update (&waiter->cond->waiters, &waiter->elem);
+    }
+}
+
+/* Orders threads in a semaphore's waiters by priority, and
+   earlier arrivals before later ones at equal priority. */
+static bool
+sema_waiter_less (const struct heap_elem *a_, const struct heap_elem *b_,
+                  void *aux UNUSED) 
+{
+  const struct thread *a = heap_entry (a_, struct thread, waitelem);
+  const struct thread *b = heap_entry (b_, struct thread, waitelem);
+
+  if (a->priority != b->priority)
+    return a->priority < b->priority;
+  return seq_after (a->wait_seq, b->wait_seq);
 }
 
 static void sema_test_helper (void *sema_);
@@ -179,12 +250,17 @@ lock_init (struct lock *lock)
 
   lock->holder = NULL;
   sema_init (&lock->semaphore, 1);
+  lock->priority = PRI_MIN;
 }
 
 /* Acquires LOCK, sleeping until it becomes available if
    necessary.  The lock must not already be held by the current
    thread.
 
+   If the lock is held, the current thread donates its priority
+   to the holder, and onward along the chain of locks the
+   holders are waiting for, before it sleeps.
+
    This function may sleep, so it must not be called within an
    interrupt handler.  This function may be called with
    interrupts disabled, but interrupts will be turned back on if
@@ -192,12 +268,23 @@ lock_init (struct lock *lock)
 void
 lock_acquire (struct lock *lock)
 {
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
   ASSERT (lock != NULL);
   ASSERT (!intr_context ());
   ASSERT (!lock_held_by_current_thread (lock));
 
+  old_level = intr_disable ();
+  if (lock->holder != NULL && !thread_mlfqs)
+    {
+      cur->waiting_lock = lock;
+      lock_donate (lock, cur->priority);
+    }
   sema_down (&lock->semaphore);
-  lock->holder = thread_current ();
+  cur->waiting_lock = NULL;
+  lock_grant (lock, cur);
+  intr_set_level (old_level);
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -211,16 +298,22 @@ lock_try_acquire (struct lock *lock)
 {
   bool success;
 
+  enum intr_level old_level;
+
   ASSERT (lock != NULL);
   ASSERT (!lock_held_by_current_thread (lock));
 
+  old_level = intr_disable ();
   success = sema_try_down (&lock->semaphore);
   if (success)
-    lock->holder = thread_current ();
+    lock_grant (lock, thread_current ());
+  intr_set_level (old_level);
   return success;
 }
 
 /* Releases LOCK, which must be owned by the current thread.
+   The current thread gives up the priority donated through
+   LOCK, which may cause it to yield.
 
    An interrupt handler cannot acquire a lock, so it does not
    make sense to try to release a lock within an interrupt
@@ -228,11 +321,18 @@ lock_try_acquire (struct lock *lock)
 void
 lock_release (struct lock *lock) 
 {
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
   ASSERT (lock != NULL);
   ASSERT (lock_held_by_current_thread (lock));
 
+  old_level = intr_disable ();
+  heap_remove (&cur->held_locks, &lock->elem);
   lock->holder = NULL;
+  thread_update_priority (cur);
   sema_up (&lock->semaphore);
+  intr_set_level (old_level);
 }
 
 /* Returns true if the current thread holds LOCK, false
@@ -246,12 +346,65 @@ lock_held_by_current_thread (const struct lock *lock)
   return lock->holder == thread_current ();
 }
 
-/* One semaphore in a list. */
-struct semaphore_elem 
-  {
-    struct list_elem elem;              /* List element. */
-    struct semaphore semaphore;         /* This semaphore. */
-  };
+/* Orders locks in a thread's held_locks by donated priority. */
+bool
+lock_priority_less (const struct heap_elem *a_, const struct heap_elem *b_,
+                    void *aux UNUSED) 
+{
+  const struct lock *a = heap_entry (a_, struct lock, elem);
+  const struct lock *b = heap_entry (b_, struct lock, elem);
+
+  return a->priority < b->priority;
+}
+
+/* Donates PRIORITY to the holder of LOCK.  If the holder is
+   itself waiting for a lock, the donation continues to that
+   lock's holder, and so on, for at most lock_donation_depth
+   locks.  The walk stops early once a holder already runs at
+   PRIORITY or higher, because everything further along the
+   chain must then be at least as high.  Interrupts must be
+   off. */
+static void
+lock_donate (struct lock *lock, int priority) 
+{
+  unsigned depth;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  for (depth = 0; depth < lock_donation_depth; depth++) 
+    {
+      struct thread *holder;
+
+      if (lock == NULL || lock->holder == NULL || priority <= lock->priority)
+        break;
+      holder = lock->holder;
+      lock->priority = priority;
+      heap_increase (&holder->held_locks, &lock->elem);
+      if (priority <= holder->priority)
+        break;
+      thread_update_priority (holder);
+      lock = holder->waiting_lock;
+    }
+}
+
+/* Makes T the holder of LOCK.  The threads still waiting for
+   LOCK now donate to T, and the first of them in the heap has
+   the highest priority.  Interrupts must be off. */
+static void
+lock_grant (struct lock *lock, struct thread *t) 
+{
+  struct heap *waiters = &lock->semaphore.waiters;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  lock->holder = t;
+  lock->priority = PRI_MIN;
+  if (!thread_mlfqs && !heap_empty (waiters))
+    lock->priority = heap_entry (heap_top (waiters),
+                                 struct thread, waitelem)->priority;
+  heap_push (&t->held_locks, &lock->elem);
+  thread_update_priority (t);
+}
 
 /* Initializes condition variable COND.  A condition variable
    allows one piece of code to signal a condition and cooperating
@@ -261,7 +414,8 @@ cond_init (struct condition *cond)
 {
   ASSERT (cond != NULL);
 
-  list_init (&cond->waiters);
+  heap_init (&cond->waiters, cond_waiter_less, NULL);
+  cond->next_seq = 0;
 }
 
 /* Atomically releases LOCK and waits for COND to be signaled by
@@ -287,7 +441,9 @@ cond_init (struct condition *cond)
 void
 cond_wait (struct condition *cond, struct lock *lock) 
 {
+  struct thread *cur = thread_current ();
   struct semaphore_elem waiter;
+  enum intr_level old_level;
 
   ASSERT (cond != NULL);
   ASSERT (lock != NULL);
@@ -295,15 +451,25 @@ cond_wait (struct condition *cond, struct lock *lock)
   ASSERT (lock_held_by_current_thread (lock));
   
   sema_init (&waiter.semaphore, 0);
-  list_push_back (&cond->waiters, &waiter.elem);
+  waiter.cond = cond;
+  waiter.priority = cur->priority;
+
+  old_level = intr_disable ();
+  waiter.seq = cond->next_seq++;
+  heap_push (&cond->waiters, &waiter.elem);
+  cur->cond_waiter = &waiter;
+  intr_set_level (old_level);
+
   lock_release (lock);
   sema_down (&waiter.semaphore);
+  cur->cond_waiter = NULL;
   lock_acquire (lock);
 }
 
 /* If any threads are waiting on COND (protected by LOCK), then
-   this function signals one of them to wake up from its wait.
-   LOCK must be held before calling this function.
+   this function signals the highest-priority one of them to wake
+   up from its wait.  LOCK must be held before calling this
+   function.
 
    An interrupt handler cannot acquire a lock, so it does not
    make sense to try to signal a condition variable within an
@@ -311,14 +477,25 @@ cond_wait (struct condition *cond, struct lock *lock)
 void
 cond_signal (struct condition *cond, struct lock *lock UNUSED) 
 {
+  struct semaphore_elem *waiter = NULL;
+  enum intr_level old_level;
+
   ASSERT (cond != NULL);
   ASSERT (lock != NULL);
   ASSERT (!intr_context ());
   ASSERT (lock_held_by_current_thread (lock));
 
-  if (!list_empty (&cond->waiters)) 
-    sema_up (&list_entry (list_pop_front (&cond->waiters),
-                          struct semaphore_elem, elem)->semaphore);
+  old_level = intr_disable ();
+  if (!heap_empty (&cond->waiters)) 
+    {
+      waiter = heap_entry (heap_pop (&cond->waiters),
+                           struct semaphore_elem, elem);
+      waiter->cond = NULL;
+    }
+  intr_set_level (old_level);
+
+  if (waiter != NULL)
+    sema_up (&waiter->semaphore);
 }
 
 /* Wakes up all threads, if any, waiting on COND (protected by
@@ -333,6 +510,21 @@ cond_broadcast (struct condition *cond, struct lock *lock)
   ASSERT (cond != NULL);
   ASSERT (lock != NULL);
 
-  while (!list_empty (&cond->waiters))
+  while (!heap_empty (&cond->waiters))
     cond_signal (cond, lock);
 }
+
+/* Orders semaphore_elems in a condition's waiters by the
+   priority of their waiting threads, and earlier arrivals
+   before later ones at equal priority. */
+static bool
+cond_waiter_less (const struct heap_elem *a_, const struct heap_elem *b_,
+                  void *aux UNUSED) 
+{
+  const struct semaphore_elem *a = heap_entry (a_, struct semaphore_elem, elem);
+  const struct semaphore_elem *b = heap_entry (b_, struct semaphore_elem, elem);
+
+  if (a->priority != b->priority)
+    return a->priority < b->priority;
+  return seq_after (a->seq, b->seq);
+}
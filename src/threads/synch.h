@@ -1,14 +1,20 @@
 #ifndef THREADS_SYNCH_H
 #define THREADS_SYNCH_H
 
+#include <heap.h>
 #include <list.h>
 #include <stdbool.h>
 
-/* A counting semaphore. */
+struct thread;
+
+/* A counting semaphore.  Waiters are kept in a max-heap ordered
+   by priority, and in arrival order among equal priorities, so
+   sema_up() wakes the most urgent waiter in O(log n). */
 struct semaphore 
   {
     unsigned value;             /* Current value. */
-    struct list waiters;        /* List of waiting threads. */
+    struct heap waiters;        /* Heap of waiting threads. */
+    unsigned next_seq;          /* Arrival number for next waiter. */
   };
 
 void sema_init (struct semaphore *, unsigned value);
@@ -16,24 +22,44 @@ void sema_down (struct semaphore *);
 bool sema_try_down (struct semaphore *);
 void sema_up (struct semaphore *);
 void sema_self_test (void);
+void sema_requeue (struct thread *);
+
+/* Lock.
 
-/* Lock. */
+   A thread that has to wait for a lock donates its priority to
+   the lock, and through it to the lock's holder.  The holder
+   keeps the locks it holds in a max-heap ordered by donated
+   priority, so its effective priority is its own priority or
+   the priority at the top of that heap, whichever is higher. */
 struct lock 
   {
-    struct thread *holder;      /* Thread holding lock (for debugging). */
+    struct thread *holder;      /* Thread holding lock. */
     struct semaphore semaphore; /* Binary semaphore controlling access. */
+    int priority;               /* Highest priority donated by a waiter. */
+    struct heap_elem elem;      /* Element in holder's held_locks. */
   };
 
+/* Default for lock_donation_depth. */
+#define LOCK_DONATION_DEPTH_DEFAULT 8
+
+/* Maximum number of locks followed by one priority donation
+   along a chain of lock holders that are waiting for locks.
+   Set by kernel command-line option "-donate-depth". */
+extern unsigned lock_donation_depth;
+
 void lock_init (struct lock *);
 void lock_acquire (struct lock *);
 bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
 bool lock_held_by_current_thread (const struct lock *);
+heap_less_func lock_priority_less;
 
-/* Condition variable. */
+/* Condition variable.  Like a semaphore's, its waiters are
+   ordered by priority and then by arrival. */
 struct condition 
   {
-    struct list waiters;        /* List of waiting semaphore_elems. */
+    struct heap waiters;        /* Heap of waiting semaphore_elems. */
+    unsigned next_seq;          /* Arrival number for next waiter. */
   };
 
 void cond_init (struct condition *);
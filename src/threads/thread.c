@@ -8,12 +8,13 @@
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
 #include "threads/palloc.h"
+#include "threads/sched-trace.h"
 #include "threads/switch.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
+#include "devices/timer.h"
 #ifdef USERPROG
 #include "userprog/process.h"
-#include "threads/malloc.h"
 #endif
 
 /* Random value for struct thread's `magic' member.
@@ -21,9 +22,22 @@
    of thread.h for details. */
 #define THREAD_MAGIC 0xcd6abf4b
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
+/* Number of distinct thread priorities. */
+#define PRI_CNT (PRI_MAX - PRI_MIN + 1)
+#if PRI_CNT > 64
+#error ready_bitmap needs one bit per priority level
+#endif
+
+/* Run queue of processes in THREAD_READY state, that is,
+   processes that are ready to run but not actually running.
+   There is one FIFO list per priority level.  Bit P of
+   ready_bitmap is set if and only if ready_queues[P - PRI_MIN]
+   is nonempty, so the highest-priority ready thread is found
+   with a single bit scan instead of a walk over every ready
+   thread. */
+static struct list ready_queues[PRI_CNT];
+static uint64_t ready_bitmap;
+static size_t ready_cnt;        /* # of threads in ready_queues. */
 
 /* List of all processes.  Processes are added to this list
    when they are first scheduled and removed when they exit. */
@@ -38,6 +52,18 @@ static struct thread *initial_thread;
 /* Lock used by allocate_tid(). */
 static struct lock tid_lock;
 
+/* Thread pages. */
+static struct slab_cache thread_cache;
+
+#ifdef USERPROG
+/* Process bookkeeping. */
+struct slab_cache list_cache;
+struct slab_cache manager_cache;
+struct slab_cache sema_cache;
+struct slab_cache lock_cache;
+struct slab_cache fd_cache;
+#endif
+
 /* Stack frame for kernel_thread(). */
 struct kernel_thread_frame 
   {
@@ -54,12 +80,32 @@ static long long user_ticks;    /* # of timer ticks in user programs. */
 /* Scheduling. */
 #define TIME_SLICE 4            /* # of timer ticks to give each thread. */
 static unsigned thread_ticks;   /* # of timer ticks since last yield. */
+static int64_t sched_ticks;     /* # of timer ticks reported to us. */
+
+/* Why the thread being switched away from gave up the CPU.  Set
+   by schedule() for thread_schedule_tail(). */
+static enum sched_reason switch_reason;
 
 /* If false (default), use round-robin scheduler.
    If true, use multi-level feedback queue scheduler.
    Controlled by kernel command-line option "-mlfqs". */
 bool thread_mlfqs;
 
+/* MLFQS state.
+
+   Every second the scheduler decays each thread's recent_cpu by
+   a factor that depends on the current load average.  Only
+   runnable threads are decayed on time.  A blocked thread is
+   brought up to date when it is unblocked, by replaying the
+   decay factors of the seconds it spent blocked, which are kept
+   in decay_history.  Seconds older than MLFQS_HISTORY are
+   dropped: by then their contribution to recent_cpu has been
+   multiplied by MLFQS_HISTORY factors less than 1. */
+#define MLFQS_HISTORY 64                /* Must be a power of 2. */
+static fixed_t load_avg;                /* System load average. */
+static unsigned mlfqs_secs;             /* Seconds of decay so far. */
+static fixed_t decay_history[MLFQS_HISTORY];   /* By second. */
+
 static void kernel_thread (thread_func *, void *aux);
 
 static void idle (void *aux UNUSED);
@@ -68,9 +114,18 @@ static struct thread *next_thread_to_run (void);
 static void init_thread (struct thread *, const char *name, int priority);
 static bool is_thread (struct thread *) UNUSED;
 static void *alloc_frame (struct thread *, size_t size);
-static void schedule (void);
+static void yield (enum sched_reason);
+static void schedule (enum sched_reason);
 void thread_schedule_tail (struct thread *prev);
 static tid_t allocate_tid (void);
+static void ready_queue_push (struct thread *);
+static void ready_queue_remove (struct thread *);
+static struct thread *ready_queue_pop (void);
+static int ready_queue_max_priority (void);
+static void mlfqs_tick (struct thread *);
+static void mlfqs_second (struct thread *);
+static void mlfqs_catch_up (struct thread *);
+static int mlfqs_priority (const struct thread *);
 
 /* Initializes the threading system by transforming the code
    that's currently running into a thread.  This can't work in
@@ -88,12 +143,28 @@ static tid_t allocate_tid (void);
 void
 thread_init (void) 
 {
+  int i;
+
   ASSERT (intr_get_level () == INTR_OFF);
 
   lock_init (&tid_lock);
-  list_init (&ready_list);
+  for (i = 0; i < PRI_CNT; i++)
+    list_init (&ready_queues[i]);
+  ready_bitmap = 0;
+  ready_cnt = 0;
   list_init (&all_list);
 
+  /* init_thread() initializes the struct thread, so the rest of
+     a thread page needs no zeroing. */
+  slab_cache_init (&thread_cache, "thread", PGSIZE, NULL);
+#ifdef USERPROG
+  slab_cache_init (&list_cache, "list", sizeof (struct list), NULL);
+  slab_cache_init (&manager_cache, "manager", sizeof (struct manager), NULL);
+  slab_cache_init (&sema_cache, "semaphore", sizeof (struct semaphore), NULL);
+  slab_cache_init (&lock_cache, "lock", sizeof (struct lock), NULL);
+  slab_cache_init (&fd_cache, "fd", sizeof (struct file_descriptor), NULL);
+#endif
+
   /* Set up a thread structure for the running thread. */
   initial_thread = running_thread ();
   init_thread (initial_thread, "main", PRI_DEFAULT);
@@ -109,9 +180,11 @@ thread_start (void)
   /* Create the idle thread. */
   struct semaphore idle_started;
   sema_init (&idle_started, 0);
-  struct list *managers = (struct list *) malloc(sizeof(struct list));
+#ifdef USERPROG
+  struct list *managers = slab_alloc(&list_cache);
   list_init(managers);
   thread_current()->managers = managers;
+#endif
   thread_create ("idle", PRI_MIN, idle, &idle_started);
 
   /* Start preemptive thread scheduling. */
@@ -121,35 +194,150 @@ thread_start (void)
   sema_down (&idle_started);
 }
 
-/* Returns the number of threads currently in the ready list */
+/* Returns the number of threads currently in the run queue. */
 size_t
 threads_ready (void)
 {
-  return list_size (&ready_list);      
+  return ready_cnt;
 }
 
-/* Called by the timer interrupt handler at each timer tick.
-   Thus, this function runs in an external interrupt context. */
+/* Called by the timer interrupt handler at each timer tick,
+   with the frame F of the code the tick interrupted.  Thus, this
+   function runs in an external interrupt context. */
 void
-thread_tick (void) 
+thread_tick (const struct intr_frame *f) 
 {
   struct thread *t = thread_current ();
 
-  /* Update statistics. */
+  /* Update statistics.  The tick is charged to user mode if it
+     interrupted code running at privilege level 3. */
   if (t == idle_thread)
     idle_ticks++;
-#ifdef USERPROG
-  else if (t->pagedir != NULL)
-    user_ticks++;
-#endif
-  else
-    kernel_ticks++;
+  else if ((f->cs & 3) == 3) 
+    {
+      user_ticks++;
+      t->usage.user_ticks++;
+    }
+  else 
+    {
+      kernel_ticks++;
+      t->usage.kernel_ticks++;
+    }
+
+  sched_ticks++;
+  if (thread_mlfqs)
+    mlfqs_tick (t);
 
   /* Enforce preemption. */
   if (++thread_ticks >= TIME_SLICE)
     intr_yield_on_return ();
 }
 
+/* Called by the timer interrupt handler for each tick that
+   passed while the idle thread ran with the periodic timer tick
+   stopped, in place of the thread_tick() call that the tick
+   would have made.  The tick may be reported after another
+   thread has started running. */
+void
+thread_idle_tick (void) 
+{
+  idle_ticks++;
+  sched_ticks++;
+  if (thread_mlfqs)
+    mlfqs_tick (idle_thread);
+}
+
+/* Does the MLFQS bookkeeping for a timer tick during which T was
+   running.  Only T's own values change between once-per-second
+   updates, so only T needs its priority recomputed. */
+static void
+mlfqs_tick (struct thread *t)
+{
+  int64_t now = sched_ticks;
+
+  if (t != idle_thread)
+    t->recent_cpu = fp_add_int (t->recent_cpu, 1);
+
+  if (now % TIMER_FREQ == 0)
+    mlfqs_second (t);
+  else if (now % TIME_SLICE == 0 && t != idle_thread)
+    t->priority = mlfqs_priority (t);
+  else
+    return;
+
+  thread_yield_to_higher ();
+}
+
+/* Updates the load average and decays recent_cpu of every
+   runnable thread, given that CUR is running.  Blocked threads
+   are left to mlfqs_catch_up().  The ready threads change
+   priority, so they are pulled out of the run queue and
+   reinserted. */
+static void
+mlfqs_second (struct thread *cur)
+{
+  struct list ready;
+  fixed_t twice_load;
+  int running = cur != idle_thread;
+  int i;
+
+  load_avg = (fp_mul (load_avg, fp_div (fp_from_int (59), fp_from_int (60)))
+              + fp_from_int ((int) ready_cnt + running) / 60);
+  twice_load = 2 * load_avg;
+  mlfqs_secs++;
+  decay_history[mlfqs_secs & (MLFQS_HISTORY - 1)]
+    = fp_div (twice_load, fp_add_int (twice_load, 1));
+
+  list_init (&ready);
+  for (i = 0; i < PRI_CNT; i++)
+    while (!list_empty (&ready_queues[i]))
+      list_push_back (&ready, list_pop_front (&ready_queues[i]));
+  ready_bitmap = 0;
+  ready_cnt = 0;
+
+  while (!list_empty (&ready))
+    {
+      struct thread *t = list_entry (list_pop_front (&ready),
+                                     struct thread, elem);
+      mlfqs_catch_up (t);
+      ready_queue_push (t);
+    }
+  if (running)
+    mlfqs_catch_up (cur);
+}
+
+/* Applies the recent_cpu decay of every second that T has not
+   seen yet, then recomputes T's priority. */
+static void
+mlfqs_catch_up (struct thread *t)
+{
+  unsigned missed = mlfqs_secs - t->recent_cpu_secs;
+  unsigned s;
+
+  if (missed > MLFQS_HISTORY)
+    missed = MLFQS_HISTORY;
+  for (s = mlfqs_secs - missed + 1; s != mlfqs_secs + 1; s++)
+    t->recent_cpu = fp_add_int (fp_mul (decay_history[s & (MLFQS_HISTORY - 1)],
+                                        t->recent_cpu),
+                                t->nice);
+  t->recent_cpu_secs = mlfqs_secs;
+  t->priority = mlfqs_priority (t);
+}
+
+/* Returns the MLFQS priority that T's recent_cpu and nice
+   values call for. */
+static int
+mlfqs_priority (const struct thread *t)
+{
+  int priority = PRI_MAX - fp_trunc (t->recent_cpu / 4) - t->nice * 2;
+
+  if (priority < PRI_MIN)
+    return PRI_MIN;
+  if (priority > PRI_MAX)
+    return PRI_MAX;
+  return priority;
+}
+
 /* Prints thread statistics. */
 void
 thread_print_stats (void) 
@@ -170,9 +358,9 @@ thread_print_stats (void)
    scheduled.  Use a semaphore or some other form of
    synchronization if you need to ensure ordering.
 
-   The code provided sets the new thread's `priority' member to
-   PRIORITY, but no actual priority scheduling is implemented.
-   Priority scheduling is the goal of Problem 1-3. */
+   If the new thread has a higher priority than the running
+   thread, it preempts the running thread before thread_create()
+   returns. */
 tid_t
 thread_create (const char *name, int priority,
                thread_func *function, void *aux) 
@@ -187,7 +375,7 @@ thread_create (const char *name, int priority,
   ASSERT (function != NULL);
 
   /* Allocate thread. */
-  t = palloc_get_page (PAL_ZERO);
+  t = slab_alloc (&thread_cache);
   if (t == NULL) 
     return TID_ERROR;
 
@@ -221,20 +409,20 @@ thread_create (const char *name, int priority,
 #ifdef USERPROG
   if (strcmp(name, "idle") != 0) {
     /* Initialises file descriptors list. */
-    struct list *fd_list = (struct list *) malloc(sizeof(struct list));
+    struct list *fd_list = slab_alloc(&list_cache);
 
-    struct manager *manager = (struct manager *) malloc(sizeof(struct manager));
-    struct list *managers = (struct list *) malloc(sizeof(struct list));
-    struct semaphore *sema = (struct semaphore *) malloc(sizeof(struct semaphore));
-    struct lock *lock = (struct lock *) malloc(sizeof(struct lock));
+    struct manager *manager = slab_alloc(&manager_cache);
+    struct list *managers = slab_alloc(&list_cache);
+    struct semaphore *sema = slab_alloc(&sema_cache);
+    struct lock *lock = slab_alloc(&lock_cache);
 
     if (manager == NULL || managers == NULL || sema == NULL || lock == NULL || fd_list == NULL) {
-      free(manager);
-      free(managers);
-      free(sema);
-      free(lock);
-      free(fd_list);
-      palloc_free_page(t);
+      slab_free(&manager_cache, manager);
+      slab_free(&list_cache, managers);
+      slab_free(&sema_cache, sema);
+      slab_free(&lock_cache, lock);
+      slab_free(&list_cache, fd_list);
+      slab_free(&thread_cache, t);
       return TID_ERROR;
     }
 
@@ -258,6 +446,7 @@ thread_create (const char *name, int priority,
 
   /* Add to run queue. */
   thread_unblock (t);
+  thread_yield_to_higher ();
 
   return tid;
 }
@@ -275,7 +464,7 @@ thread_block (void)
   ASSERT (intr_get_level () == INTR_OFF);
 
   thread_current ()->status = THREAD_BLOCKED;
-  schedule ();
+  schedule (SCHED_BLOCK);
 }
 
 /* Transitions a blocked thread T to the ready-to-run state.
@@ -285,7 +474,8 @@ thread_block (void)
    This function does not preempt the running thread.  This can
    be important: if the caller had disabled interrupts itself,
    it may expect that it can atomically unblock a thread and
-   update other data. */
+   update other data.  Call thread_yield_to_higher() afterward
+   to let a higher-priority T run. */
 void
 thread_unblock (struct thread *t) 
 {
@@ -295,7 +485,9 @@ thread_unblock (struct thread *t)
 
   old_level = intr_disable ();
   ASSERT (t->status == THREAD_BLOCKED);
-  list_push_back (&ready_list, &t->elem);
+  if (thread_mlfqs)
+    mlfqs_catch_up (t);
+  ready_queue_push (t);
   t->status = THREAD_READY;
   intr_set_level (old_level);
 }
@@ -350,7 +542,7 @@ thread_exit (void)
   intr_disable ();
   list_remove (&thread_current()->allelem);
   thread_current ()->status = THREAD_DYING;
-  schedule ();
+  schedule (SCHED_EXIT);
   NOT_REACHED ();
 }
 
@@ -358,6 +550,24 @@ thread_exit (void)
    may be scheduled again immediately at the scheduler's whim. */
 void
 thread_yield (void) 
+{
+  yield (SCHED_YIELD);
+}
+
+/* Yields the CPU because another thread should run instead, as
+   opposed to the current thread giving it up of its own accord.
+   Called when a time slice expires or a higher-priority thread
+   becomes ready. */
+void
+thread_preempt (void) 
+{
+  yield (SCHED_PREEMPT);
+}
+
+/* Yields the CPU for REASON, either SCHED_YIELD or
+   SCHED_PREEMPT. */
+static void
+yield (enum sched_reason reason) 
 {
   struct thread *cur = thread_current ();
   enum intr_level old_level;
@@ -366,12 +576,34 @@ thread_yield (void)
 
   old_level = intr_disable ();
   if (cur != idle_thread) 
-    list_push_back (&ready_list, &cur->elem);
+    ready_queue_push (cur);
   cur->status = THREAD_READY;
-  schedule ();
+  schedule (reason);
   intr_set_level (old_level);
 }
 
+/* Yields the CPU if some ready thread has a higher priority than
+   the running thread.  Within an external interrupt handler the
+   yield is deferred until the handler returns. */
+void
+thread_yield_to_higher (void)
+{
+  enum intr_level old_level;
+  bool preempt;
+
+  old_level = intr_disable ();
+  preempt = (ready_cnt > 0
+             && ready_queue_max_priority () > running_thread ()->priority);
+  intr_set_level (old_level);
+
+  if (!preempt)
+    return;
+  if (intr_context ())
+    intr_yield_on_return ();
+  else
+    thread_preempt ();
+}
+
 /* Invoke function 'func' on all threads, passing along 'aux'.
    This function must be called with interrupts off. */
 void
@@ -389,49 +621,121 @@ thread_foreach (thread_action_func *func, void *aux)
     }
 }
 
-/* Sets the current thread's priority to NEW_PRIORITY. */
+/* Sets the current thread's priority to NEW_PRIORITY.  Priority
+   donated to the thread is kept, so its effective priority does
+   not drop below that.  Yields if the running thread no longer
+   has the highest priority.  Ignored by the MLFQS, which sets
+   priorities itself. */
 void
 thread_set_priority (int new_priority) 
 {
-  thread_current ()->priority = new_priority;
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  ASSERT (PRI_MIN <= new_priority && new_priority <= PRI_MAX);
+
+  if (thread_mlfqs)
+    return;
+
+  old_level = intr_disable ();
+  cur->base_priority = new_priority;
+  thread_update_priority (cur);
+  intr_set_level (old_level);
+
+  thread_yield_to_higher ();
 }
 
-/* Returns the current thread's priority. */
+/* Recomputes T's effective priority: the higher of its own
+   priority and the top of its heap of donations.  If T is in
+   the run queue, moves it to the queue for its new priority.
+   Interrupts must be off.  Does nothing under the MLFQS, which
+   does not use donation. */
+void
+thread_update_priority (struct thread *t) 
+{
+  int priority = t->base_priority;
+
+  ASSERT (is_thread (t));
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (thread_mlfqs)
+    return;
+
+  if (!heap_empty (&t->held_locks)) 
+    {
+      struct lock *top = heap_entry (heap_top (&t->held_locks),
+                                     struct lock, elem);
+      if (top->priority > priority)
+        priority = top->priority;
+    }
+
+  if (priority == t->priority)
+    return;
+  if (t->status == THREAD_READY) 
+    {
+      ready_queue_remove (t);
+      t->priority = priority;
+      ready_queue_push (t);
+    }
+  else
+    {
+      t->priority = priority;
+      if (t->status == THREAD_BLOCKED && t->waiting_sema != NULL)
+        sema_requeue (t);
+    }
+}
+
+/* Returns the current thread's effective priority. */
 int
 thread_get_priority (void) 
 {
   return thread_current ()->priority;
 }
 
-/* Sets the current thread's nice value to NICE. */
+/* Sets the current thread's nice value to NICE, which must be
+   between NICE_MIN and NICE_MAX, and recomputes its priority. */
 void
-thread_set_nice (int nice UNUSED) 
+thread_set_nice (int nice) 
 {
-  /* Not yet implemented. */
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  ASSERT (NICE_MIN <= nice && nice <= NICE_MAX);
+
+  old_level = intr_disable ();
+  cur->nice = nice;
+  if (thread_mlfqs)
+    cur->priority = mlfqs_priority (cur);
+  intr_set_level (old_level);
+
+  thread_yield_to_higher ();
 }
 
 /* Returns the current thread's nice value. */
 int
 thread_get_nice (void) 
 {
-  /* Not yet implemented. */
-  return 0;
+  return thread_current ()->nice;
 }
 
 /* Returns 100 times the system load average. */
 int
 thread_get_load_avg (void) 
 {
-  /* Not yet implemented. */
-  return 0;
+  enum intr_level old_level = intr_disable ();
+  int load = fp_round (load_avg * 100);
+  intr_set_level (old_level);
+  return load;
 }
 
 /* Returns 100 times the current thread's recent_cpu value. */
 int
 thread_get_recent_cpu (void) 
 {
-  /* Not yet implemented. */
-  return 0;
+  enum intr_level old_level = intr_disable ();
+  int recent_cpu = fp_round (thread_current ()->recent_cpu * 100);
+  intr_set_level (old_level);
+  return recent_cpu;
 }
 
 /* Idle thread.  Executes when no other thread is ready to run.
@@ -456,6 +760,10 @@ idle (void *idle_started_ UNUSED)
       intr_disable ();
       thread_block ();
 
+      /* In tickless mode, stop the periodic timer tick until the
+         next tick that has work to do. */
+      timer_idle_begin ();
+
       /* Re-enable interrupts and wait for the next one.
 
          The `sti' instruction disables interrupts until the
@@ -519,9 +827,21 @@ init_thread (struct thread *t, const char *name, int priority)
   t->status = THREAD_BLOCKED;
   strlcpy (t->name, name, sizeof t->name);
   t->stack = (uint8_t *) t + PGSIZE;
-  t->priority = priority;
+  t->priority = t->base_priority = priority;
+  heap_init (&t->held_locks, lock_priority_less, NULL);
   t->magic = THREAD_MAGIC;
 
+  /* A new thread inherits its creator's MLFQS state, except for
+     the initial thread, which is its own creator. */
+  if (t != running_thread ())
+    {
+      t->nice = running_thread ()->nice;
+      t->recent_cpu = running_thread ()->recent_cpu;
+    }
+  t->recent_cpu_secs = mlfqs_secs;
+  if (thread_mlfqs)
+    t->priority = mlfqs_priority (t);
+
   old_level = intr_disable ();
   list_push_back (&all_list, &t->allelem);
   intr_set_level (old_level);
@@ -548,10 +868,76 @@ alloc_frame (struct thread *t, size_t size)
 static struct thread *
 next_thread_to_run (void) 
 {
-  if (list_empty (&ready_list))
+  if (ready_cnt == 0)
     return idle_thread;
   else
-    return list_entry (list_pop_front (&ready_list), struct thread, elem);
+    return ready_queue_pop ();
+}
+
+/* Appends T to the run queue for its priority.  Interrupts must
+   be off. */
+static void
+ready_queue_push (struct thread *t)
+{
+  int pri = t->priority;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (PRI_MIN <= pri && pri <= PRI_MAX);
+
+  list_push_back (&ready_queues[pri - PRI_MIN], &t->elem);
+  ready_bitmap |= (uint64_t) 1 << (pri - PRI_MIN);
+  ready_cnt++;
+}
+
+/* Removes T from the run queue.  Interrupts must be off. */
+static void
+ready_queue_remove (struct thread *t)
+{
+  int idx = t->priority - PRI_MIN;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (t->status == THREAD_READY);
+
+  list_remove (&t->elem);
+  if (list_empty (&ready_queues[idx]))
+    ready_bitmap &= ~((uint64_t) 1 << idx);
+  ready_cnt--;
+}
+
+/* Removes and returns the first thread of the highest-priority
+   nonempty run queue.  The run queue must not be empty and
+   interrupts must be off. */
+static struct thread *
+ready_queue_pop (void)
+{
+  int idx = ready_queue_max_priority () - PRI_MIN;
+  struct list *queue = &ready_queues[idx];
+  struct thread *t;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  t = list_entry (list_pop_front (queue), struct thread, elem);
+  if (list_empty (queue))
+    ready_bitmap &= ~((uint64_t) 1 << idx);
+  ready_cnt--;
+  return t;
+}
+
+/* Returns the highest priority of any thread in the run queue,
+   which must not be empty.  Uses BSR on each half of
+   ready_bitmap, since i386 has no 64-bit bit scan. */
+static int
+ready_queue_max_priority (void)
+{
+  uint32_t hi = ready_bitmap >> 32;
+  uint32_t lo = ready_bitmap;
+
+  ASSERT (ready_bitmap != 0);
+
+  if (hi != 0)
+    return PRI_MIN + 63 - __builtin_clz (hi);
+  else
+    return PRI_MIN + 31 - __builtin_clz (lo);
 }
 
 /* Completes a thread switch by activating the new thread's page
@@ -583,6 +969,10 @@ thread_schedule_tail (struct thread *prev)
   /* Start new time slice. */
   thread_ticks = 0;
 
+  /* Trace the switch, before PREV can be destroyed. */
+  if (prev != NULL)
+    sched_trace_record (prev->tid, cur->tid, switch_reason);
+
 #ifdef USERPROG
   /* Activate the new address space. */
   process_activate ();
@@ -591,12 +981,12 @@ thread_schedule_tail (struct thread *prev)
   /* If the thread we switched from is dying, destroy its struct
      thread.  This must happen late so that thread_exit() doesn't
      pull out the rug under itself.  (We don't free
-     initial_thread because its memory was not obtained via
-     palloc().) */
+     initial_thread because its memory was not obtained from
+     thread_cache.) */
   if (prev != NULL && prev->status == THREAD_DYING && prev != initial_thread) 
     {
       ASSERT (prev != cur);
-      palloc_free_page (prev);
+      slab_free (&thread_cache, prev);
     }
 }
 
@@ -605,10 +995,13 @@ thread_schedule_tail (struct thread *prev)
    running to some other state.  This function finds another
    thread to run and switches to it.
 
+   REASON tells why the running process is giving up the CPU,
+   for its resource usage and for the scheduler trace.
+
    It's not safe to call printf() until thread_schedule_tail()
    has completed. */
 static void
-schedule (void) 
+schedule (enum sched_reason reason) 
 {
   struct thread *cur = running_thread ();
   struct thread *next = next_thread_to_run ();
@@ -618,8 +1011,21 @@ schedule (void)
   ASSERT (cur->status != THREAD_RUNNING);
   ASSERT (is_thread (next));
 
-  if (cur != next)
-    prev = switch_threads (cur, next);
+  /* Whatever woke the CPU, the periodic tick must run again
+     before idle gives way, and the ticks idle slept through must
+     be counted as idle. */
+  if (cur == idle_thread)
+    timer_idle_end ();
+
+  if (cur != next) 
+    {
+      if (reason == SCHED_BLOCK || reason == SCHED_YIELD)
+        cur->usage.voluntary_switches++;
+      else if (reason == SCHED_PREEMPT)
+        cur->usage.involuntary_switches++;
+      switch_reason = reason;
+      prev = switch_threads (cur, next);
+    }
   thread_schedule_tail (prev);
 }
 
@@ -2,9 +2,14 @@
 #define THREADS_THREAD_H
 
 #include <debug.h>
+#include <hash.h>
+#include <heap.h>
 #include <list.h>
+#include <rbtree.h>
+#include <rusage.h>
 #include <stdint.h>
-
+#include "threads/fixed-point.h"
+#include "threads/slab.h"
 
 /* States in a thread's life cycle. */
 enum thread_status
@@ -25,6 +30,11 @@ typedef int tid_t;
 #define PRI_DEFAULT 31                  /* Default priority. */
 #define PRI_MAX 63                      /* Highest priority. */
 
+/* Thread niceness, for the MLFQS. */
+#define NICE_MIN -20                    /* Most willing to run. */
+#define NICE_DEFAULT 0                  /* Default niceness. */
+#define NICE_MAX 20                     /* Least willing to run. */
+
 #ifdef USERPROG
 #define THREAD_ALIVE -2                 /* Default exit_status when thread created. */
 #define THREAD_EXIT -1                  /* exit_status when a thread dies via thread_exit() instead of sys_exit(). */
@@ -80,12 +90,10 @@ typedef int tid_t;
    the `magic' member of the running thread's `struct thread' is
    set to THREAD_MAGIC.  Stack overflow will normally change this
    value, triggering the assertion. */
-/* The `elem' member has a dual purpose.  It can be an element in
-   the run queue (thread.c), or it can be an element in a
-   semaphore wait list (synch.c).  It can be used these two ways
-   only because they are mutually exclusive: only a thread in the
-   ready state is on the run queue, whereas only a thread in the
-   blocked state is on a semaphore wait list. */
+/* The `elem' member is an element in the run queue (thread.c).
+   A thread waiting on a semaphore is instead in the semaphore's
+   heap of waiters (synch.c) through its `waitelem' member, which
+   lets the heap be reordered when a waiter's priority changes. */
 struct thread
   {
     /* Owned by thread.c. */
@@ -93,9 +101,29 @@ struct thread
     enum thread_status status;          /* Thread state. */
     char name[16];                      /* Name (for debugging purposes). */
     uint8_t *stack;                     /* Saved stack pointer. */
-    int priority;                       /* Priority. */
+    int priority;                       /* Effective priority. */
     struct list_elem allelem;           /* List element for all threads list. */
 
+    /* Shared between thread.c and synch.c, for priority donation. */
+    int base_priority;                  /* Priority before donations. */
+    struct heap held_locks;             /* Locks held, by donated priority. */
+    struct lock *waiting_lock;          /* Lock being waited for, if any. */
+
+    /* Owned by synch.c. */
+    struct heap_elem waitelem;          /* Element in semaphore's waiters. */
+    struct semaphore *waiting_sema;     /* Semaphore being waited for, if any. */
+    struct semaphore_elem *cond_waiter; /* Condition wait in progress, if any. */
+    unsigned wait_seq;                  /* Arrival number among waiters. */
+
+    /* Owned by thread.c, for the MLFQS. */
+    int nice;                           /* Niceness. */
+    fixed_t recent_cpu;                 /* Recent CPU usage. */
+    unsigned recent_cpu_secs;           /* Seconds recent_cpu is decayed to. */
+
+    /* Resource usage.  Ticks and context switches are counted by
+       thread.c; the rest by whoever does the work. */
+    struct rusage usage;                /* This thread's own usage. */
+
     /* Shared between thread.c and synch.c. */
     struct list_elem elem;              /* List element. */
 
@@ -106,6 +134,13 @@ struct thread
     struct list *managers;              /* List of child processes */
     struct manager *manager;            /* Element of parent's managers list */
     struct file *executable;            /* Executable file associated with thread. */
+    struct rusage child_usage;          /* Usage of children waited for. */
+#ifdef VM
+    struct hash pages;                  /* Supplemental page table. */
+    struct rb_tree vmas;                /* Virtual memory areas. */
+    struct list mappings;               /* Files mapped by mmap(). */
+    void *user_esp;                     /* User %esp on kernel entry. */
+#endif
 #endif
 
     /* Owned by thread.c. */
@@ -127,8 +162,18 @@ struct manager {
   struct semaphore *wait_sema;          /* For making parent wait. */
   struct lock *rw_lock;                 /* For reading and writing. */
   struct list_elem elem;                /* List element for managers list. */
+  struct rusage usage;                  /* Child's total usage, written when it exits. */
 };
 
+#ifdef USERPROG
+/* Slab caches for process bookkeeping, set up by thread_init(). */
+extern struct slab_cache list_cache;    /* struct list. */
+extern struct slab_cache manager_cache; /* struct manager. */
+extern struct slab_cache sema_cache;    /* struct semaphore. */
+extern struct slab_cache lock_cache;    /* struct lock. */
+extern struct slab_cache fd_cache;      /* struct file_descriptor. */
+#endif
+
 
 /* If false (default), use round-robin scheduler.
    If true, use multi-level feedback queue scheduler.
@@ -139,7 +184,9 @@ void thread_init (void);
 void thread_start (void);
 size_t threads_ready(void);
 
-void thread_tick (void);
+struct intr_frame;
+void thread_tick (const struct intr_frame *);
+void thread_idle_tick (void);
 void thread_print_stats (void);
 
 typedef void thread_func (void *aux);
@@ -154,6 +201,8 @@ const char *thread_name (void);
 
 void thread_exit (void) NO_RETURN;
 void thread_yield (void);
+void thread_preempt (void);
+void thread_yield_to_higher (void);
 
 /* Performs some operation on thread t, given auxiliary data AUX. */
 typedef void thread_action_func (struct thread *t, void *aux);
@@ -161,6 +210,7 @@ void thread_foreach (thread_action_func *, void *);
 
 int thread_get_priority (void);
 void thread_set_priority (int);
+void thread_update_priority (struct thread *);
 
 int thread_get_nice (void);
 void thread_set_nice (int);
@@ -4,6 +4,13 @@
 #include "userprog/gdt.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/vaddr.h"
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/page.h"
+#include "vm/vma.h"
+#include "vm/zcache.h"
+#endif
 
 /* Number of page faults processed. */
 static long long page_fault_cnt;
@@ -62,6 +69,19 @@ void
 exception_print_stats (void) 
 {
   printf ("Exception: %lld page faults\n", page_fault_cnt);
+#ifdef VM
+  printf ("Faults: %lld minor, %lld major\n",
+          page_minor_fault_cnt, page_major_fault_cnt);
+  printf ("Paging: %lld evictions, %lld file reads, "
+          "%lld copy-on-write copies, %lld shared text pages, "
+          "%lld zero pages\n",
+          frame_evict_cnt, page_file_in_cnt, page_cow_cnt,
+          page_text_share_cnt, page_zero_cnt);
+  printf ("Swap: %lld pages out in %lld writes, %lld pages in, "
+          "%lld read ahead\n", page_swap_out_cnt, page_swap_write_cnt,
+          page_swap_in_cnt, page_read_ahead_cnt);
+  zcache_print_stats ();
+#endif
 }
 
 /* Handler for an exception (probably) caused by a user process. */
@@ -139,15 +159,50 @@ page_fault (struct intr_frame *f)
 
   /* Count page faults. */
   page_fault_cnt++;
+  thread_current ()->usage.page_faults++;
 
   /* Determine cause. */
   not_present = (f->error_code & PF_P) == 0;
   write = (f->error_code & PF_W) != 0;
   user = (f->error_code & PF_U) != 0;
 
-  /* To implement virtual memory, delete the rest of the function
-     body, and replace it with code that brings in the page to
-     which fault_addr refers. */
+#ifdef VM
+  /* Bring in the process's page at FAULT_ADDR, if it has one, or
+     grow its stack to cover FAULT_ADDR.  The kernel faults here too
+     when a system call touches a user buffer that is not resident;
+     then the user's %esp is the one saved on entry to the kernel. */
+  if (not_present && is_user_vaddr (fault_addr)
+      && thread_current ()->pagedir != NULL)
+    {
+      void *esp = user ? f->esp : thread_current ()->user_esp;
+
+      if (page_in (fault_addr, write)
+          || (vma_grow_stack (fault_addr, esp)
+              && page_in (fault_addr, write)))
+        return;
+    }
+
+  /* A write to a page shared copy-on-write since fork() gets the
+     writer its own copy.  The kernel faults here too, since it
+     honours read-only pages, when a system call writes into such a
+     page. */
+  if (!not_present && write && is_user_vaddr (fault_addr)
+      && thread_current ()->pagedir != NULL && page_cow (fault_addr))
+    return;
+#endif
+
+  /* A system call that hands the kernel a bad user pointer ends the
+     process, as the same access from user mode would.  With a lock
+     held, exiting could leave shared state half updated, so that
+     case is still treated as a kernel bug. */
+  if (!user && is_user_vaddr (fault_addr)
+      && thread_current ()->pagedir != NULL
+      && heap_empty (&thread_current ()->held_locks))
+    {
+      thread_current ()->exit_status = -1;
+      thread_exit ();
+    }
+
   printf ("Page fault at %p: %s error %s page in %s context.\n",
           fault_addr,
           not_present ? "not present" : "rights violation",
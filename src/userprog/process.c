@@ -19,6 +19,11 @@
 #include "threads/vaddr.h"
 #include "threads/synch.h"
 #include "threads/malloc.h"
+#ifdef VM
+#include "vm/mmap.h"
+#include "vm/page.h"
+#include "vm/vma.h"
+#endif
 #define MAX_CMD_SIZE 2000
 #define MAX_POINTER_ARRAY_SIZE 500
 
@@ -31,9 +36,24 @@ static void parent_exit(struct list *);
 static void free_fds(struct list *);
 
 static void free_manager(struct manager *);
+static void rusage_add(struct rusage *, const struct rusage *);
 
 static int load_and_process(char *, struct intr_frame *);
 static void parse_arg(struct intr_frame *, char *, int);
+static tid_t wait_for_load(tid_t);
+
+#ifdef VM
+/* What process_fork() hands to the child it creates. */
+struct fork_args
+  {
+    struct thread *parent;              /* Process being copied. */
+    const struct intr_frame *if_;       /* Its registers in fork(). */
+  };
+
+static thread_func start_fork NO_RETURN;
+static bool copy_process (struct thread *parent);
+static struct file *fork_file (struct file *, void *parent);
+#endif
 
 /* Starts a new thread running a user program loaded from
    FILENAME. The new thread may be scheduled (and may even exit)
@@ -62,6 +82,13 @@ process_execute (const char *file_name)
     palloc_free_page (fn_copy);
 
   /* Waits for child to finish loading executable. */
+  return wait_for_load(tid);
+}
+
+/* Waits for child TID to finish loading its executable, or setting
+   itself up as a copy of its parent.  Returns TID if it succeeded,
+   otherwise TID_ERROR. */
+static tid_t wait_for_load(tid_t tid) {
   struct list *managers = thread_current()->managers;
   struct manager *manager; struct list_elem *e;
   bool load_status = false;
@@ -75,6 +102,110 @@ process_execute (const char *file_name)
   return load_status ? tid : TID_ERROR;
 }
 
+#ifdef VM
+/* Starts a new process that is a copy of the running one.  The
+   two share their memory copy-on-write, and the child has its own
+   handles on the parent's open and mapped files.  The child
+   returns 0 from the system call whose registers are IF.  Returns
+   the child's thread id, or TID_ERROR if it cannot be created. */
+tid_t
+process_fork (const struct intr_frame *if_) 
+{
+  struct fork_args args;
+  tid_t tid;
+
+  args.parent = thread_current ();
+  args.if_ = if_;
+  tid = thread_create (thread_current ()->name, PRI_DEFAULT, start_fork,
+                       &args);
+
+  /* ARGS must outlive the child's copy of the parent. */
+  return wait_for_load (tid);
+}
+
+/* A thread function that makes the new thread a copy of the
+   process that called process_fork(), and starts it running
+   where that process entered fork(), returning 0. */
+static void
+start_fork (void *args_) 
+{
+  struct fork_args *args = args_;
+  struct intr_frame if_ = *args->if_;
+  bool success = copy_process (args->parent);
+
+  thread_current ()->manager->load_status = success;
+  sema_up (thread_current ()->manager->wait_sema);
+  if (!success)
+    thread_exit ();
+
+  if_.eax = 0;
+  asm volatile ("movl %0, %%esp; jmp intr_exit" : : "g" (&if_) : "memory");
+  NOT_REACHED ();
+}
+
+/* Makes the running thread's process a copy of PARENT, which must
+   not run meanwhile.  Returns false if memory runs out. */
+static bool
+copy_process (struct thread *parent) 
+{
+  struct thread *t = thread_current ();
+  struct list_elem *e;
+  bool success;
+
+  t->pagedir = pagedir_create ();
+  if (t->pagedir == NULL)
+    return false;
+  mmap_table_init (&t->mappings);
+  if (!page_table_init (&t->pages))
+    return false;
+  vma_table_init (&t->vmas);
+  process_activate ();
+
+  /* Every file gets a handle of its own, at the same position. */
+  lock_acquire (filesys_lock);
+  t->executable = file_reopen (parent->executable);
+  if (t->executable != NULL)
+    file_deny_write (t->executable);
+  success = t->executable != NULL && mmap_table_copy (parent);
+  for (e = list_begin (parent->file_descriptors);
+       success && e != list_end (parent->file_descriptors);
+       e = list_next (e))
+    {
+      struct file_descriptor *fd = list_entry (e, struct file_descriptor,
+                                               elem);
+      struct file_descriptor *copy = slab_alloc (&fd_cache);
+
+      if (copy == NULL || (copy->file = file_reopen (fd->file)) == NULL)
+        {
+          slab_free (&fd_cache, copy);
+          success = false;
+          break;
+        }
+      file_seek (copy->file, file_tell (fd->file));
+      copy->fd = fd->fd;
+      list_push_back (t->file_descriptors, &copy->elem);
+    }
+  lock_release (filesys_lock);
+
+  return (success
+          && vma_table_copy (parent, fork_file, parent)
+          && page_table_copy (parent));
+}
+
+/* Returns the running process's handle on the file that its
+   parent, PARENT_, reads part of its address space from.  For
+   vma_table_copy(). */
+static struct file *
+fork_file (struct file *file, void *parent_) 
+{
+  struct thread *parent = parent_;
+
+  if (file == parent->executable)
+    return thread_current ()->executable;
+  return mmap_copy_file (parent, file);
+}
+#endif
+
 
 /* A thread function that loads a user process and starts it
    running. */
@@ -135,6 +266,7 @@ process_wait (tid_t child_tid)
       sema_down(manager->wait_sema);
       lock_acquire(manager->rw_lock);
       int exit_status = manager->exit_status;
+      rusage_add(&thread_current()->child_usage, &manager->usage);
       list_remove(&manager->elem);
       free_manager(manager);
       return exit_status;
@@ -153,6 +285,20 @@ process_exit (void)
   struct manager *manager = cur->manager;
   struct list *managers = cur->managers;
 
+#ifdef VM
+  /* Mapped files are written back, then frames and swap slots
+     go, while their mappings are still in the page directory.
+     This must come before the executable is closed: frames
+     shared with other processes running it are found by its
+     inode, which must not be freed and reused while they are
+     still registered. */
+  if (cur->pagedir != NULL) {
+    mmap_table_destroy ();
+    page_table_destroy ();
+    vma_table_destroy ();
+  }
+#endif
+
   /* Allow writes to the executable file. */
   if (cur->executable != NULL) {
     file_allow_write(cur->executable);
@@ -169,6 +315,8 @@ process_exit (void)
 
   if (cur->file_descriptors != NULL) {
     free_fds(cur->file_descriptors);
+    slab_free(&list_cache, cur->file_descriptors);
+    cur->file_descriptors = NULL;
   }
 
   /* Destroy the current process's page directory and switch back
@@ -273,6 +421,9 @@ static bool validate_segment (const struct Elf32_Phdr *, struct file *);
 static bool load_segment (struct file *file, off_t ofs, uint8_t *upage,
                           uint32_t read_bytes, uint32_t zero_bytes,
                           bool writable);
+#ifdef VM
+static bool preload_segments (void);
+#endif
 
 /* Loads an ELF executable from FILE_NAME into the current thread.
    Stores the executable's entry point into *EIP
@@ -292,6 +443,12 @@ load (const char *file_name, void (**eip) (void), void **esp)
   t->pagedir = pagedir_create ();
   if (t->pagedir == NULL) 
     goto done;
+#ifdef VM
+  mmap_table_init (&t->mappings);
+  if (!page_table_init (&t->pages))
+    goto done;
+  vma_table_init (&t->vmas);
+#endif
   process_activate ();
 
   /* Open executable file. */
@@ -374,6 +531,11 @@ load (const char *file_name, void (**eip) (void), void **esp)
         }
     }
 
+#ifdef VM
+  if (page_eager_load && !preload_segments ())
+    goto done;
+#endif
+
   /* Set up stack. */
   if (!setup_stack (esp))
     goto done;
@@ -385,13 +547,26 @@ load (const char *file_name, void (**eip) (void), void **esp)
 
  done:
   /* We arrive here whether the load is successful or not. */
+#ifdef VM
+  /* Pages not yet touched are read from FILE, so keep it open as
+     the process's executable.  Even if loading failed, pages
+     read in eagerly may hold frames registered by its inode, so
+     only process_exit() closes it, once they are gone. */
+  if (file != NULL) {
+    file_deny_write (file);
+    t->executable = file;
+    file = NULL;
+  }
+#endif
   file_close (file);
   return success;
 }
 
 /* load() helpers. */
 
+#ifndef VM
 static bool install_page (void *upage, void *kpage, bool writable);
+#endif
 
 /* Checks whether PHDR describes a valid, loadable segment in
    FILE and returns true if so, false otherwise. */
@@ -452,6 +627,86 @@ validate_segment (const struct Elf32_Phdr *phdr, struct file *file)
 
    Return true if successful, false if a memory allocation error
    or disk read error occurs. */
+#ifdef VM
+static bool
+load_segment (struct file *file, off_t ofs, uint8_t *upage,
+              uint32_t read_bytes, uint32_t zero_bytes, bool writable) 
+{
+  struct thread *t = thread_current ();
+
+  ASSERT ((read_bytes + zero_bytes) % PGSIZE == 0);
+  ASSERT (pg_ofs (upage) == 0);
+  ASSERT (ofs % PGSIZE == 0);
+
+  /* A segment may start in the last page of the one before it.
+     Both read that page from the same file page, since offsets
+     and addresses agree modulo the page size, so the shared page
+     keeps the previous area and just reads more of the file. */
+  if (vma_find (t, upage) != NULL) {
+    size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
+    struct page *page = page_get (upage);
+
+    if (page == NULL){
+      return false;
+    }
+    /* If the page is already in memory, it may share its frame
+       with other processes running this program, so the first
+       write goes through page_cow() to get a private copy. */
+    if (writable) {
+      page->writable = true;
+    }
+    if (page_read_bytes > page->read_bytes) {
+      page->file = file;
+      page->file_ofs = ofs;
+      page->read_bytes = page_read_bytes;
+    }
+
+    read_bytes -= page_read_bytes;
+    zero_bytes -= PGSIZE - page_read_bytes;
+    upage += PGSIZE;
+    ofs += PGSIZE;
+    if (read_bytes + zero_bytes == 0){
+      return true;
+    }
+  }
+
+  /* Only record where the pages come from; each is read in when
+     the process first touches it. */
+  if (vma_map (upage, read_bytes + zero_bytes, VMA_FILE, writable,
+               file, ofs, read_bytes) == NULL){
+    return false;
+  }
+
+  return true;
+}
+
+/* Reads in every page of the executable that holds bytes of the
+   file, for the -eager-load option.  Runs only once load() has
+   recorded all the segments, since a segment that starts in the
+   last page of the one before it adds to what that page reads.
+   Pages past the file's bytes are zeros, and are left to the zero
+   page until written.  Returns false if a page cannot be read. */
+static bool
+preload_segments (void)
+{
+  struct thread *t = thread_current ();
+  struct rb_elem *e;
+
+  for (e = rb_first (&t->vmas); e != NULL; e = rb_next (e)) {
+    struct vma *v = rb_entry (e, struct vma, elem);
+    uint8_t *upage;
+
+    for (upage = v->start; upage < v->start + v->file_bytes;
+         upage += PGSIZE) {
+      struct page *page = page_get (upage);
+      if (page == NULL || !page_preload (page)){
+        return false;
+      }
+    }
+  }
+  return true;
+}
+#else
 static bool
 load_segment (struct file *file, off_t ofs, uint8_t *upage,
               uint32_t read_bytes, uint32_t zero_bytes, bool writable) 
@@ -510,15 +765,30 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
     }
   return true;
 }
+#endif
 
 /* Create a minimal stack by mapping a zeroed page at the top of
    user virtual memory. */
 static bool
 setup_stack (void **esp) 
 {
-  uint8_t *kpage;
   bool success = false;
 
+#ifdef VM
+  uint8_t *upage = ((uint8_t *) PHYS_BASE) - PGSIZE;
+  struct page *page = NULL;
+
+  if (vma_map (upage, PGSIZE, VMA_STACK, true, NULL, 0, 0) != NULL)
+    page = page_get (upage);
+  if (page != NULL && page_pin (page) != NULL)
+    {
+      page_unpin (page);
+      *esp = PHYS_BASE;
+      success = true;
+    }
+#else
+  uint8_t *kpage;
+
   kpage = palloc_get_page (PAL_USER | PAL_ZERO);
   if (kpage != NULL) 
     {
@@ -528,9 +798,11 @@ setup_stack (void **esp)
       else
         palloc_free_page (kpage);
     }
+#endif
   return success;
 }
 
+#ifndef VM
 /* Adds a mapping from user virtual address UPAGE to kernel
    virtual address KPAGE to the page table.
    If WRITABLE is true, the user process may modify the page;
@@ -550,12 +822,19 @@ install_page (void *upage, void *kpage, bool writable)
   return (pagedir_get_page (t->pagedir, upage) == NULL
           && pagedir_set_page (t->pagedir, upage, kpage, writable));
 }
+#endif
 
 /* Child process writes its exit_status and frees manager if parent is dead. */
 static void child_exit(struct manager *manager) {
   lock_acquire(manager->rw_lock);
   manager->exit_status = thread_current()->exit_status == THREAD_ALIVE ? THREAD_EXIT : thread_current()->exit_status;
   printf("%s: exit(%d)\n", thread_current()->name, manager->exit_status);
+
+  /* Report this process's usage, including that of its own waited-for children. */
+  enum intr_level old_level = intr_disable();
+  manager->usage = thread_current()->usage;
+  intr_set_level(old_level);
+  rusage_add(&manager->usage, &thread_current()->child_usage);
   if (manager->parent_dead) {
     free_manager(manager);
   } else {
@@ -582,13 +861,24 @@ static void parent_exit(struct list *managers) {
       free_manager(manager);
     }
   }
-  free(managers);
+  slab_free(&list_cache, managers);
 }
 
 static void free_manager(struct manager *manager) {
-  free(manager->rw_lock);
-  free(manager->wait_sema);
-  free(manager);
+  slab_free(&lock_cache, manager->rw_lock);
+  slab_free(&sema_cache, manager->wait_sema);
+  slab_free(&manager_cache, manager);
+}
+
+/* Adds the resource usage in SRC to DST. */
+static void rusage_add(struct rusage *dst, const struct rusage *src) {
+  dst->user_ticks += src->user_ticks;
+  dst->kernel_ticks += src->kernel_ticks;
+  dst->voluntary_switches += src->voluntary_switches;
+  dst->involuntary_switches += src->involuntary_switches;
+  dst->page_faults += src->page_faults;
+  dst->bytes_read += src->bytes_read;
+  dst->bytes_written += src->bytes_written;
 }
 
 
@@ -606,12 +896,15 @@ static int load_and_process(char *file_name, struct intr_frame *if_) {
   thread_current()->manager->load_status = success;
   sema_up(thread_current()->manager->wait_sema);
 
-  /* Deny writes to the executable file. */
+  /* Deny writes to the executable file.  With VM, load() keeps the
+     file open for demand paging and has done this already. */
   if (success) {
+#ifndef VM
     lock_acquire(filesys_lock);
     thread_current()->executable = filesys_open(token);
     file_deny_write(thread_current()->executable);
     lock_release(filesys_lock);
+#endif
 
     /* Counts number of arguments to check for stackoverflow */
     int count = 0;
@@ -646,7 +939,7 @@ void free_fds(struct list *fds) {
     file_close(fd->file);
     list_remove(e);
     e = list_next(e);
-    free(fd);
+    slab_free(&fd_cache, fd);
   }
 }
 
@@ -8,15 +8,21 @@
 #include "threads/malloc.h"
 #include "devices/input.h"
 #include "devices/shutdown.h"
+#include "devices/timer.h"
 #include "userprog/process.h"
 #include "userprog/pagedir.h"
 #include "threads/synch.h"
 #include "lib/string.h"
+#ifdef VM
+#include "vm/mmap.h"
+#include "vm/vma.h"
+#endif
 
 static void syscall_handler (struct intr_frame *);
 
 /* Helper functions for system calls. */
 static void access_user_mem(const void *);
+static void access_user_buffer(const void *, unsigned, bool);
 uint32_t *get_arg (struct intr_frame *, int);
 static void exit(int);
 
@@ -29,9 +35,6 @@ static struct file *fd_to_file(int);
 const int STDIN_FILENUM = 0;
 const int STDOUT_FILENUM = 1;
 
-/* Maximum and minimum number values for system calls (implemented). */
-const int SYSCALL_MAX = 12;
-const int SYSCALL_MIN = 0;
 
 /* System call type definition. */
 typedef void syscall(struct intr_frame *f);
@@ -50,13 +53,40 @@ static syscall sys_write;
 static syscall sys_seek;
 static syscall sys_tell;
 static syscall sys_close;
-
-/* Function pointer table for system calls, indexed in order of and by their system call numbers. */
+static syscall sys_get_nice;
+static syscall sys_set_nice;
+static syscall sys_get_load_avg;
+static syscall sys_get_recent_cpu;
+static syscall sys_time_ns;
+static syscall sys_getrusage;
+#ifdef VM
+static syscall sys_mmap;
+static syscall sys_munmap;
+static syscall sys_fork;
+#endif
+
+/* Function pointer table for system calls, indexed by their system call numbers.
+   Unimplemented system calls are left as null pointers. */
 static void (*system_calls[]) (struct intr_frame *) = {
-  sys_halt, sys_exit, sys_exec, sys_wait, sys_create, sys_remove,
-  sys_open, sys_filesize, sys_read, sys_write, sys_seek, sys_tell, sys_close
+  [SYS_HALT] = sys_halt, [SYS_EXIT] = sys_exit, [SYS_EXEC] = sys_exec,
+  [SYS_WAIT] = sys_wait, [SYS_CREATE] = sys_create, [SYS_REMOVE] = sys_remove,
+  [SYS_OPEN] = sys_open, [SYS_FILESIZE] = sys_filesize, [SYS_READ] = sys_read,
+  [SYS_WRITE] = sys_write, [SYS_SEEK] = sys_seek, [SYS_TELL] = sys_tell,
+  [SYS_CLOSE] = sys_close,
+#ifdef VM
+  [SYS_MMAP] = sys_mmap, [SYS_MUNMAP] = sys_munmap,
+#endif
+  [SYS_GET_NICE] = sys_get_nice, [SYS_SET_NICE] = sys_set_nice,
+  [SYS_GET_LOAD_AVG] = sys_get_load_avg, [SYS_GET_RECENT_CPU] = sys_get_recent_cpu,
+  [SYS_TIME_NS] = sys_time_ns, [SYS_GETRUSAGE] = sys_getrusage,
+#ifdef VM
+  [SYS_FORK] = sys_fork
+#endif
 };
 
+/* Number of entries in system_calls. */
+#define SYSCALL_CNT (sizeof system_calls / sizeof *system_calls)
+
 /* Writes size bytes from buffer to the open file fd. Returns the number of bytes actually
 written, which may be less than size if some bytes could not be written.
 Writing past end-of-file would normally extend the file, but file growth is not implemented
@@ -97,13 +127,17 @@ syscall_init (void)
 static void
 syscall_handler (struct intr_frame *f UNUSED) 
 {
+#ifdef VM
+  /* Faults on the user stack taken inside the kernel need this to grow it. */
+  thread_current()->user_esp = f->esp;
+#endif
   uint32_t *syscall_number_address = get_arg(f, 0);
   access_user_mem(syscall_number_address);
 
   uint32_t syscall_number = *syscall_number_address;
 
-  /* Checks if the system call value is within range. */
-  if (syscall_number < SYSCALL_MIN || syscall_number > SYSCALL_MAX) {
+  /* Checks if the system call value is within range and implemented. */
+  if (syscall_number >= SYSCALL_CNT || system_calls[syscall_number] == NULL) {
     exit(-1);
   }
 
@@ -121,9 +155,51 @@ uint32_t *get_arg (struct intr_frame *f, int i) {
 
 /* Function that checks if a pointer is safe and valid. */
 static void access_user_mem (const void *uaddr) {
-  if (!is_user_vaddr(uaddr) || pagedir_get_page(thread_current()->pagedir, uaddr) == NULL) {
+  if (!is_user_vaddr(uaddr)) {
+    exit(-1);
+  }
+#ifdef VM
+  /* Pages not yet read in or swapped out are faulted in on access. */
+  if (vma_find(thread_current(), uaddr) == NULL
+      && !vma_grow_stack(uaddr, thread_current()->user_esp)) {
+    exit(-1);
+  }
+#else
+  if (pagedir_get_page(thread_current()->pagedir, uaddr) == NULL) {
+    exit(-1);
+  }
+#endif
+}
+
+/* Checks every page of the SIZE bytes at BUFFER, so that the kernel never
+   faults on the buffer while it holds a lock.  If WRITABLE, the process
+   must also be allowed to write to each page. */
+static void access_user_buffer (const void *buffer, unsigned size, bool writable) {
+  const uint8_t *start = buffer;
+  const uint8_t *last = start + (size > 0 ? size - 1 : 0);
+
+  if (last < start || !is_user_vaddr(last)) {
     exit(-1);
   }
+  for (const uint8_t *page = pg_round_down(start); page <= last; page += PGSIZE) {
+    const void *uaddr = page < start ? start : page;
+#ifdef VM
+    struct vma *v = vma_find(thread_current(), uaddr);
+
+    if (v == NULL) {
+      if (!vma_grow_stack(uaddr, thread_current()->user_esp)) {
+        exit(-1);
+      }
+      v = vma_find(thread_current(), uaddr);
+    }
+    if (v == NULL || (writable && !v->writable)) {
+      exit(-1);
+    }
+#else
+    (void) writable;
+    access_user_mem(uaddr);
+#endif
+  }
 }
 
 /* Terminates Pintos. */
@@ -204,7 +280,7 @@ static void sys_open(struct intr_frame *f) {
     return;
   }
 
-  struct file_descriptor *fd_elem = malloc(sizeof(struct file_descriptor));
+  struct file_descriptor *fd_elem = slab_alloc(&fd_cache);
 
   /* Returns -1 if memory could not be allocated for this file (descriptor). */
   if (fd_elem == NULL) {
@@ -244,7 +320,7 @@ static void sys_read(struct intr_frame *f) {
   void *buffer = (void *) *get_arg(f, 2);
   unsigned size = (unsigned) *get_arg(f, 3);
 
-  access_user_mem(buffer);
+  access_user_buffer(buffer, size, true);
 
   int bytes_read = -1;
 
@@ -255,6 +331,7 @@ static void sys_read(struct intr_frame *f) {
     for (unsigned i = 0; i < size; i++) {
       buf[i] = input_getc();
     }
+    thread_current()->usage.bytes_read += size;
     
     f->eax = size;
     return;
@@ -268,6 +345,9 @@ static void sys_read(struct intr_frame *f) {
 
     lock_release(filesys_lock);
 
+    if (bytes_read > 0) {
+      thread_current()->usage.bytes_read += bytes_read;
+    }
     f->eax = bytes_read;
     return;
   }
@@ -282,7 +362,7 @@ static void sys_write(struct intr_frame *f) {
   const void *buffer = (const void *) *get_arg(f, 2);
   unsigned size = (unsigned) *get_arg(f, 3);
 
-  access_user_mem(buffer);
+  access_user_buffer(buffer, size, false);
   int bytes_written = -1;
 
   /* Handles standard output fd value to write to console, or anything greater. */
@@ -306,9 +386,9 @@ static void sys_write(struct intr_frame *f) {
         putbuf(charBuffer, 400);
         sizeCount -= 400;
         charBuffer += 400;
-        access_user_mem(charBuffer);
       }
     }
+    thread_current()->usage.bytes_written += size;
 
     f->eax = size;
     return;
@@ -323,6 +403,9 @@ static void sys_write(struct intr_frame *f) {
 
     lock_release(filesys_lock);
 
+    if (bytes_written > 0) {
+      thread_current()->usage.bytes_written += bytes_written;
+    }
     f->eax = bytes_written;
     return;
   }
@@ -375,12 +458,122 @@ static void sys_close(struct intr_frame *f) {
     if (file_descriptor != NULL) {
       lock_acquire(filesys_lock);
       list_remove(&file_descriptor->elem);
-      free(file_descriptor);
+      slab_free(&fd_cache, file_descriptor);
       lock_release(filesys_lock);
     }
   }
 }
 
+#ifdef VM
+/* Maps the file open as fd into memory at addr, returning a mapping id or MAP_FAILED.
+   Pages are read from the file as they are touched, and only those written to are written
+   back, on munmap() or exit.  The mapping keeps its own handle, so closing fd or removing
+   the file does not affect it. */
+static void sys_mmap(struct intr_frame *f) {
+  int fd = (int) *get_arg(f, 1);
+  void *addr = (void *) *get_arg(f, 2);
+  struct file *file = fd_to_file(fd);
+
+  /* Fails on the console, a null or misaligned address, or an empty file. */
+  if (file == NULL || fd <= STDOUT_FILENUM || addr == NULL || pg_ofs(addr) != 0) {
+    f->eax = MAP_FAILED;
+    return;
+  }
+
+  lock_acquire(filesys_lock);
+  struct file *mapped = file_reopen(file);
+  off_t length = mapped != NULL ? file_length(mapped) : 0;
+  lock_release(filesys_lock);
+
+  mapid_t id = MAP_FAILED;
+  if (length > 0) {
+    id = mmap_map(mapped, length, addr);
+  }
+
+  /* Closes the new handle if it could not be mapped. */
+  if (id == MAP_FAILED && mapped != NULL) {
+    lock_acquire(filesys_lock);
+    file_close(mapped);
+    lock_release(filesys_lock);
+  }
+  f->eax = id;
+}
+
+/* Creates a copy of the calling process whose memory is shared copy-on-write.  Returns the
+   child's pid in the parent and 0 in the child, or -1 if the copy could not be made. */
+static void sys_fork(struct intr_frame *f) {
+  f->eax = process_fork(f);
+}
+
+/* Unmaps the mapping given, writing the pages that were written to back to the file. */
+static void sys_munmap(struct intr_frame *f) {
+  mapid_t mapping = (mapid_t) *get_arg(f, 1);
+  mmap_unmap(mapping);
+}
+#endif
+
+/* Returns the current process's nice value. */
+static void sys_get_nice(struct intr_frame *f) {
+  f->eax = thread_get_nice();
+}
+
+/* Sets the current process's nice value, clamped to the valid range. */
+static void sys_set_nice(struct intr_frame *f) {
+  int nice = (int) *get_arg(f, 1);
+
+  if (nice < NICE_MIN) {
+    nice = NICE_MIN;
+  } else if (nice > NICE_MAX) {
+    nice = NICE_MAX;
+  }
+  thread_set_nice(nice);
+}
+
+/* Returns 100 times the system load average. */
+static void sys_get_load_avg(struct intr_frame *f) {
+  f->eax = thread_get_load_avg();
+}
+
+/* Returns 100 times the current process's recent_cpu value. */
+static void sys_get_recent_cpu(struct intr_frame *f) {
+  f->eax = thread_get_recent_cpu();
+}
+
+/* Returns the number of nanoseconds since boot, split across EDX:EAX. */
+static void sys_time_ns(struct intr_frame *f) {
+  uint64_t ns = timer_ns();
+  f->eax = ns;
+  f->edx = ns >> 32;
+}
+
+/* Stores the resource usage of the current process, or of the children it has waited for,
+   into the user buffer USAGE.  Returns 0 if successful, -1 if WHO is invalid. */
+static void sys_getrusage(struct intr_frame *f) {
+  int who = (int) *get_arg(f, 1);
+  struct rusage *usage = (struct rusage *) *get_arg(f, 2);
+  struct thread *cur = thread_current();
+  struct rusage copy;
+
+  access_user_mem(usage);
+  access_user_mem((const char *) usage + sizeof *usage - 1);
+
+  /* Ticks are counted by the timer interrupt, so take a consistent snapshot. */
+  enum intr_level old_level = intr_disable();
+  if (who == RUSAGE_SELF) {
+    copy = cur->usage;
+  } else if (who == RUSAGE_CHILDREN) {
+    copy = cur->child_usage;
+  } else {
+    intr_set_level(old_level);
+    f->eax = -1;
+    return;
+  }
+  intr_set_level(old_level);
+
+  memcpy(usage, &copy, sizeof copy);
+  f->eax = 0;
+}
+
 /* Finds an available fd value by iterating through file_descriptors of thread. */
 static int allocate_fd(void) {
   int fd = 2; /* Starts from 2 to avoid conflicts with standard input/output values. */
@@ -0,0 +1,262 @@
+#include "vm/frame.h"
+#include <debug.h>
+#include "threads/palloc.h"
+#include "threads/slab.h"
+#include "threads/thread.h"
+#include "userprog/pagedir.h"
+#include "vm/page.h"
+
+/* Every frame handed out by frame_alloc(), in the order the
+   clock hand visits them. */
+static struct list frame_list;
+
+/* Next frame the clock hand considers for eviction, or the list
+   tail to wrap around to the front. */
+static struct list_elem *clock_hand;
+
+/* Frames holding read-only pages of executables, by inode and
+   offset, so that processes running the same program share
+   them. */
+static struct hash text_frames;
+
+/* Storage for struct frame. */
+static struct slab_cache frame_cache;
+
+struct lock frame_lock;
+long long frame_evict_cnt;
+
+static struct frame *frame_evict (void);
+static struct frame *clock_next (void);
+static bool test_and_clear_accessed (struct frame *);
+static void hold (struct frame *, struct page *);
+static hash_hash_func text_hash;
+static hash_less_func text_less;
+
+/* Initializes the frame table. */
+void
+frame_init (void) 
+{
+  lock_init (&frame_lock);
+  list_init (&frame_list);
+  clock_hand = list_end (&frame_list);
+  hash_init (&text_frames, text_hash, text_less, NULL);
+  slab_cache_init (&frame_cache, "frame", sizeof (struct frame), NULL);
+}
+
+/* Obtains a frame for page P, evicting another page if the user
+   pool is exhausted.  The frame is returned pinned; its contents
+   are undefined.  Returns a null pointer if every frame is pinned
+   or the victim cannot be written out.
+   The caller must hold frame_lock. */
+struct frame *
+frame_alloc (struct page *p) 
+{
+  struct frame *f = frame_try_alloc (p);
+
+  if (f == NULL)
+    {
+      f = frame_evict ();
+      if (f != NULL)
+        hold (f, p);
+    }
+  return f;
+}
+
+/* Like frame_alloc(), but returns a null pointer instead of
+   evicting a page when the user pool is exhausted. */
+struct frame *
+frame_try_alloc (struct page *p) 
+{
+  struct frame *f;
+  void *kpage;
+
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+
+  kpage = palloc_get_page (PAL_USER);
+  if (kpage == NULL)
+    return NULL;
+  f = slab_alloc (&frame_cache);
+  if (f == NULL)
+    {
+      palloc_free_page (kpage);
+      return NULL;
+    }
+  f->kpage = kpage;
+  hold (f, p);
+
+  /* A new frame was just touched, so the hand reaches it last. */
+  list_insert (clock_hand, &f->elem);
+  return f;
+}
+
+/* Removes frame F from the frame table and returns it to the
+   user pool.  The caller must hold frame_lock and must already
+   have unmapped F's page. */
+void
+frame_free (struct frame *f) 
+{
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+
+  frame_forget_text (f);
+  if (clock_hand == &f->elem)
+    clock_hand = list_next (clock_hand);
+  list_remove (&f->elem);
+  palloc_free_page (f->kpage);
+  slab_free (&frame_cache, f);
+}
+
+/* Returns the frame holding the read-only page at FILE_OFS in
+   executable INODE, or a null pointer if no process has it in
+   memory.  The caller must hold frame_lock. */
+struct frame *
+frame_find_text (struct inode *inode, off_t file_ofs) 
+{
+  struct frame key;
+  struct hash_elem *e;
+
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+
+  key.inode = inode;
+  key.file_ofs = file_ofs;
+  e = hash_find (&text_frames, &key.text_elem);
+  return e != NULL ? hash_entry (e, struct frame, text_elem) : NULL;
+}
+
+/* Records that frame F holds the read-only page at FILE_OFS in
+   executable INODE, which has READ_BYTES bytes of the file
+   followed by zeros, so that frame_find_text() finds it.  Returns
+   false if another frame already holds that page.  The caller
+   must hold frame_lock. */
+bool
+frame_add_text (struct frame *f, struct inode *inode, off_t file_ofs,
+                size_t read_bytes) 
+{
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+  ASSERT (f->inode == NULL);
+
+  f->inode = inode;
+  f->file_ofs = file_ofs;
+  f->read_bytes = read_bytes;
+  if (hash_insert (&text_frames, &f->text_elem) != NULL)
+    {
+      f->inode = NULL;
+      return false;
+    }
+  return true;
+}
+
+/* Stops frame F from being found by frame_find_text(), if it
+   could be.  The caller must hold frame_lock. */
+void
+frame_forget_text (struct frame *f) 
+{
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+
+  if (f->inode != NULL)
+    {
+      hash_delete (&text_frames, &f->text_elem);
+      f->inode = NULL;
+    }
+}
+
+/* Returns the frame under the clock hand and advances the hand. */
+static struct frame *
+clock_next (void) 
+{
+  struct frame *f;
+
+  if (clock_hand == list_end (&frame_list))
+    clock_hand = list_begin (&frame_list);
+  f = list_entry (clock_hand, struct frame, elem);
+  clock_hand = list_next (clock_hand);
+  return f;
+}
+
+/* Picks a victim with the second-chance clock algorithm, writes
+   its page out and returns the frame, pinned.  A frame whose page
+   was accessed since the hand last passed it has its accessed bit
+   cleared and is skipped; two full sweeps therefore suffice unless
+   every frame is pinned, in which case a null pointer is
+   returned. */
+static struct frame *
+frame_evict (void) 
+{
+  size_t tries;
+
+  if (list_empty (&frame_list))
+    return NULL;
+
+  for (tries = 2 * list_size (&frame_list); tries > 0; tries--) 
+    {
+      struct frame *f = clock_next ();
+
+      if (f->pinned || test_and_clear_accessed (f))
+        continue;
+
+      f->pinned = true;
+      if (!page_evict (f))
+        {
+          f->pinned = false;
+          return NULL;
+        }
+      frame_forget_text (f);
+      frame_evict_cnt++;
+      return f;
+    }
+  return NULL;
+}
+
+/* Returns true if any page held in frame F has been accessed
+   since the last call, clearing their accessed bits. */
+static bool
+test_and_clear_accessed (struct frame *f) 
+{
+  struct list_elem *e;
+  bool accessed = false;
+
+  for (e = list_begin (&f->pages); e != list_end (&f->pages);
+       e = list_next (e))
+    {
+      struct page *p = list_entry (e, struct page, frame_elem);
+      uint32_t *pd = p->owner->pagedir;
+
+      if (pagedir_is_accessed (pd, p->upage))
+        {
+          pagedir_set_accessed (pd, p->upage, false);
+          accessed = true;
+        }
+    }
+  return accessed;
+}
+
+/* Sets up frame F, pinned and clean, to hold page P alone. */
+static void
+hold (struct frame *f, struct page *p) 
+{
+  list_init (&f->pages);
+  list_push_back (&f->pages, &p->frame_elem);
+  f->pinned = true;
+  f->dirty = false;
+  f->inode = NULL;
+}
+
+/* Returns a hash value for the text frame F_. */
+static unsigned
+text_hash (const struct hash_elem *f_, void *aux UNUSED) 
+{
+  const struct frame *f = hash_entry (f_, struct frame, text_elem);
+  return hash_bytes (&f->inode, sizeof f->inode) ^ hash_int (f->file_ofs);
+}
+
+/* Returns true if text frame A precedes text frame B. */
+static bool
+text_less (const struct hash_elem *a_, const struct hash_elem *b_,
+           void *aux UNUSED) 
+{
+  const struct frame *a = hash_entry (a_, struct frame, text_elem);
+  const struct frame *b = hash_entry (b_, struct frame, text_elem);
+
+  if (a->inode != b->inode)
+    return a->inode < b->inode;
+  return a->file_ofs < b->file_ofs;
+}
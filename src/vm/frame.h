@@ -0,0 +1,48 @@
+#ifndef VM_FRAME_H
+#define VM_FRAME_H
+
+#include <hash.h>
+#include <list.h>
+#include <stdbool.h>
+#include "filesys/off_t.h"
+#include "threads/synch.h"
+
+struct inode;
+struct page;
+
+/* A frame of the user pool holding a page of some process, or
+   the same page of several processes: after fork(), each mapping
+   it read-only until it writes to it, or a read-only page of an
+   executable that several processes are running. */
+struct frame
+  {
+    void *kpage;                /* Kernel virtual address of the frame. */
+    struct list pages;          /* Pages held in the frame. */
+    bool pinned;                /* True if the frame may not be evicted. */
+    bool dirty;                 /* Modified through a mapping since
+                                   removed from it. */
+    struct inode *inode;        /* Executable whose read-only page
+                                   this is, or null. */
+    off_t file_ofs;             /* Offset of the page in INODE. */
+    size_t read_bytes;          /* Bytes of INODE in the page. */
+    struct hash_elem text_elem; /* Element in the text table. */
+    struct list_elem elem;      /* Element in the clock list. */
+  };
+
+/* Serializes paging: the frame table, the page tables' resident
+   state and the swap traffic that moves pages between them. */
+extern struct lock frame_lock;
+
+/* Frames reclaimed by the clock hand. */
+extern long long frame_evict_cnt;
+
+void frame_init (void);
+struct frame *frame_alloc (struct page *);
+struct frame *frame_try_alloc (struct page *);
+void frame_free (struct frame *);
+struct frame *frame_find_text (struct inode *, off_t file_ofs);
+bool frame_add_text (struct frame *, struct inode *, off_t file_ofs,
+                     size_t read_bytes);
+void frame_forget_text (struct frame *);
+
+#endif /* vm/frame.h */
@@ -0,0 +1,241 @@
+#include "vm/mmap.h"
+#include <debug.h>
+#include <round.h>
+#include "filesys/file.h"
+#include "threads/slab.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "userprog/process.h"
+#include "vm/frame.h"
+#include "vm/page.h"
+#include "vm/vma.h"
+
+/* Storage for struct mapping. */
+static struct slab_cache mapping_cache;
+
+static struct mapping *find (mapid_t);
+static void unmap (struct mapping *);
+static void write_back (struct page *);
+static void close_file (struct file *);
+
+/* Initializes the mapping allocator. */
+void
+mmap_init (void) 
+{
+  slab_cache_init (&mapping_cache, "mapping", sizeof (struct mapping), NULL);
+}
+
+/* Initializes MAPPINGS as an empty mapping list. */
+void
+mmap_table_init (struct list *mappings) 
+{
+  list_init (mappings);
+}
+
+/* Unmaps every mapping of the running process, writing modified
+   pages back to their files.  Must be called while the process's
+   page directory is still intact. */
+void
+mmap_table_destroy (void) 
+{
+  struct list *mappings = &thread_current ()->mappings;
+
+  while (!list_empty (mappings))
+    unmap (list_entry (list_front (mappings), struct mapping, elem));
+}
+
+/* Gives the running process, which is being created by fork(), a
+   mapping for each of PARENT's, with the same identifier and
+   address and its own handle on the file.  The pages come with the
+   areas, which must be copied separately.  The caller must hold
+   filesys_lock.  Returns false if memory allocation fails. */
+bool
+mmap_table_copy (struct thread *parent) 
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&parent->mappings); e != list_end (&parent->mappings);
+       e = list_next (e))
+    {
+      struct mapping *m = list_entry (e, struct mapping, elem);
+      struct mapping *copy = slab_alloc (&mapping_cache);
+
+      if (copy == NULL)
+        return false;
+      *copy = *m;
+      copy->file = file_reopen (m->file);
+      if (copy->file == NULL)
+        {
+          slab_free (&mapping_cache, copy);
+          return false;
+        }
+      list_push_back (&thread_current ()->mappings, &copy->elem);
+    }
+  return true;
+}
+
+/* Returns the running process's handle on the file that PARENT
+   has mapped through FILE, after mmap_table_copy(), or a null
+   pointer if PARENT has no mapping of FILE. */
+struct file *
+mmap_copy_file (struct thread *parent, struct file *file) 
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&parent->mappings); e != list_end (&parent->mappings);
+       e = list_next (e))
+    {
+      struct mapping *m = list_entry (e, struct mapping, elem);
+
+      if (m->file == file)
+        {
+          struct mapping *copy = find (m->id);
+          return copy != NULL ? copy->file : NULL;
+        }
+    }
+  return NULL;
+}
+
+/* Maps the LENGTH bytes of FILE into the running process at ADDR,
+   which must be page-aligned.  The rest of the last page reads as
+   zeros.  No page is read until it is touched.  The mapping owns
+   FILE from then on, and closes it when it is unmapped.  Returns
+   the new mapping's identifier, or MAP_FAILED, leaving FILE open,
+   if the range overlaps an area of the process or memory
+   allocation fails. */
+mapid_t
+mmap_map (struct file *file, off_t length, void *addr) 
+{
+  struct thread *cur = thread_current ();
+  struct mapping *m;
+  mapid_t id = 0;
+
+  ASSERT (pg_ofs (addr) == 0);
+  ASSERT (length > 0);
+
+  m = slab_alloc (&mapping_cache);
+  if (m == NULL)
+    return MAP_FAILED;
+  m->file = file;
+  m->addr = addr;
+  m->size = ROUND_UP ((size_t) length, PGSIZE);
+  if (vma_map (m->addr, m->size, VMA_FILE, true, file, 0, length) == NULL)
+    {
+      slab_free (&mapping_cache, m);
+      return MAP_FAILED;
+    }
+
+  /* Take the lowest identifier not in use. */
+  while (find (id) != NULL)
+    id++;
+  m->id = id;
+  list_push_back (&cur->mappings, &m->elem);
+  return id;
+}
+
+/* Removes mapping ID of the running process, writing modified
+   pages back to its file.  Returns false if there is no such
+   mapping. */
+bool
+mmap_unmap (mapid_t id) 
+{
+  struct mapping *m = find (id);
+
+  if (m == NULL)
+    return false;
+  unmap (m);
+  return true;
+}
+
+/* Returns the running process's mapping ID, or a null pointer if
+   it has none. */
+static struct mapping *
+find (mapid_t id) 
+{
+  struct list *mappings = &thread_current ()->mappings;
+  struct list_elem *e;
+
+  for (e = list_begin (mappings); e != list_end (mappings); e = list_next (e))
+    {
+      struct mapping *m = list_entry (e, struct mapping, elem);
+      if (m->id == id)
+        return m;
+    }
+  return NULL;
+}
+
+/* Writes M's modified pages back, removes its area and frees
+   it. */
+static void
+unmap (struct mapping *m) 
+{
+  struct thread *cur = thread_current ();
+  uint8_t *upage;
+
+  /* Each page goes as soon as it has been written, so that it is
+     not written to swap, only to be dropped, while the rest are
+     written. */
+  for (upage = m->addr; upage < m->addr + m->size; upage += PGSIZE) 
+    {
+      struct page *p = page_lookup (cur, upage);
+      if (p != NULL)
+        {
+          write_back (p);
+          page_remove (p);
+        }
+    }
+  vma_unmap (m->addr, m->size);
+
+  list_remove (&m->elem);
+  close_file (m->file);
+  slab_free (&mapping_cache, m);
+}
+
+/* Writes page P of a mapping to its file if the process has
+   modified it.  That is so if it is dirty, or if it has a copy in
+   swap, because only dirty pages are written to swap: a clean one
+   is dropped and read from the file again.  A frame shared since
+   fork() records modifications through mappings that are gone. */
+static void
+write_back (struct page *p) 
+{
+  bool fs_locked = lock_held_by_current_thread (filesys_lock);
+  bool modified;
+  void *kpage;
+
+  lock_acquire (&frame_lock);
+  modified = (p->swap_slot != SWAP_NONE
+              || (p->frame != NULL
+                  && (p->frame->dirty
+                      || pagedir_is_dirty (p->owner->pagedir, p->upage))));
+  lock_release (&frame_lock);
+  if (!modified || p->read_bytes == 0)
+    return;
+
+  /* Bring the page back if it was evicted in the meantime, and
+     keep it while the file is written. */
+  kpage = page_pin (p);
+  if (kpage == NULL)
+    return;
+  if (!fs_locked)
+    lock_acquire (filesys_lock);
+  file_write_at (p->file, kpage, p->read_bytes, p->file_ofs);
+  if (!fs_locked)
+    lock_release (filesys_lock);
+  page_unpin (p);
+}
+
+/* Closes FILE under filesys_lock. */
+static void
+close_file (struct file *file) 
+{
+  bool fs_locked = lock_held_by_current_thread (filesys_lock);
+
+  if (!fs_locked)
+    lock_acquire (filesys_lock);
+  file_close (file);
+  if (!fs_locked)
+    lock_release (filesys_lock);
+}
@@ -0,0 +1,36 @@
+#ifndef VM_MMAP_H
+#define VM_MMAP_H
+
+#include <list.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "filesys/off_t.h"
+
+struct thread;
+
+/* Identifies a mapping within its process. */
+typedef int mapid_t;
+#define MAP_FAILED ((mapid_t) -1)
+
+/* A file mapped into a process's address space by mmap().  The
+   pages themselves belong to the VMA_FILE area at ADDR, and are
+   read in from FILE as they are touched. */
+struct mapping
+  {
+    mapid_t id;                 /* Identifier returned by mmap(). */
+    struct file *file;          /* File, opened for this mapping. */
+    uint8_t *addr;              /* First mapped address. */
+    size_t size;                /* Bytes mapped, whole pages. */
+    struct list_elem elem;      /* Element in owner's mapping list. */
+  };
+
+void mmap_init (void);
+void mmap_table_init (struct list *);
+void mmap_table_destroy (void);
+bool mmap_table_copy (struct thread *parent);
+struct file *mmap_copy_file (struct thread *parent, struct file *);
+
+mapid_t mmap_map (struct file *, off_t length, void *addr);
+bool mmap_unmap (mapid_t);
+
+#endif /* vm/mmap.h */
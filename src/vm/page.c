@@ -0,0 +1,971 @@
+#include "vm/page.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <string.h>
+#include "devices/swap.h"
+#include "filesys/file.h"
+#include "threads/palloc.h"
+#include "threads/slab.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "userprog/process.h"
+#include "vm/frame.h"
+#include "vm/vma.h"
+
+/* Storage for struct page. */
+static struct slab_cache page_cache;
+
+/* A page of zeros, mapped read-only by every page that is read
+   before it is ever written. */
+static void *zero_kpage;
+
+long long page_swap_out_cnt;
+long long page_swap_in_cnt;
+long long page_swap_write_cnt;
+long long page_read_ahead_cnt;
+long long page_file_in_cnt;
+long long page_cow_cnt;
+long long page_text_share_cnt;
+long long page_zero_cnt;
+long long page_minor_fault_cnt;
+long long page_major_fault_cnt;
+
+/* Number of pages, aligned, around a faulting page that a read
+   fault maps in too if they are already in memory.  Set by the
+   -fault-around kernel option; 1 or less turns it off. */
+int page_fault_around = 16;
+
+/* If true, neighbouring pages share swap clusters, are written
+   out together and read back ahead of use.  Cleared by the
+   -no-swap-cluster kernel option. */
+bool page_swap_cluster = true;
+
+/* If true, load() fills every page of the executable up front.
+   Set by the -eager-load kernel option to compare against demand
+   paging. */
+bool page_eager_load;
+
+static hash_hash_func page_hash;
+static hash_less_func page_less;
+static hash_action_func page_destroy;
+static void *pin (struct page *, bool fs_locked, bool fault);
+static void count_fault (bool major);
+static void fault_around (struct page *);
+static bool fill (struct page *, void *kpage, bool fs_locked);
+static size_t gather_run (struct page *, struct frame *,
+                          struct page *run[], struct frame *frames[]);
+static struct frame *read_ahead_frame (struct thread *, uint8_t *group,
+                                       size_t i, size_t base);
+static bool write_cluster (struct page *);
+static bool map_zero (struct page *);
+static bool is_text (const struct page *);
+static struct frame *find_text (struct page *);
+static bool join (struct page *, struct frame *);
+static bool shared (struct frame *);
+static struct page *frame_page (struct list_elem *);
+
+/* Initializes the page allocator. */
+void
+page_init (void) 
+{
+  slab_cache_init (&page_cache, "page", sizeof (struct page), NULL);
+  zero_kpage = palloc_get_page (PAL_ASSERT | PAL_ZERO);
+}
+
+/* Initializes PAGES as an empty supplemental page table.
+   Returns false if memory allocation fails. */
+bool
+page_table_init (struct hash *pages) 
+{
+  return hash_init (pages, page_hash, page_less, NULL);
+}
+
+/* Releases every page of the running process: its frame, its swap
+   slot and its entry.  Must be called while the process's page
+   directory is still intact. */
+void
+page_table_destroy (void) 
+{
+  lock_acquire (&frame_lock);
+  hash_destroy (&thread_current ()->pages, page_destroy);
+  lock_release (&frame_lock);
+}
+
+/* Gives the running process, which is being created by fork(), a
+   copy of each of PARENT's pages.  Resident pages share their
+   frames, mapped read-only in both processes until one of them
+   writes (see page_cow()), and swapped-out pages share their swap
+   slots.  The process's areas must already have been copied, and
+   PARENT must not run meanwhile.  Returns false if memory
+   allocation fails. */
+bool
+page_table_copy (struct thread *parent) 
+{
+  struct thread *cur = thread_current ();
+  struct hash_iterator i;
+  bool success = true;
+
+  lock_acquire (&frame_lock);
+  hash_first (&i, &parent->pages);
+  while (success && hash_next (&i)) 
+    {
+      struct page *p = hash_entry (hash_cur (&i), struct page, elem);
+      struct frame *f = p->frame;
+      struct page *c = slab_alloc (&page_cache);
+
+      if (c == NULL)
+        {
+          success = false;
+          break;
+        }
+      *c = *p;
+      c->owner = cur;
+      c->frame = NULL;
+      if (c->file != NULL)
+        c->file = vma_find (cur, c->upage)->file;
+      if (c->swap_slot != SWAP_NONE)
+        swap_share (c->swap_slot);
+      hash_insert (&cur->pages, &c->elem);
+
+      if (f != NULL)
+        {
+          if (!pagedir_set_page (cur->pagedir, c->upage, f->kpage, false))
+            success = false;
+          else
+            {
+              /* The parent's dirty bit survives, so the frame is
+                 still written out if it was modified. */
+              pagedir_set_writable (parent->pagedir, p->upage, false);
+              list_push_back (&f->pages, &c->frame_elem);
+              c->frame = f;
+            }
+        }
+    }
+  lock_release (&frame_lock);
+  return success;
+}
+
+/* Adds an empty, zero-filled page at UPAGE to the running
+   process's page table.  No frame is allocated until the page is
+   first pinned or touched.  Returns a null pointer if UPAGE is
+   already present or memory allocation fails. */
+struct page *
+page_create (void *upage, bool writable) 
+{
+  struct thread *cur = thread_current ();
+  struct page *p;
+
+  ASSERT (pg_ofs (upage) == 0);
+  ASSERT (is_user_vaddr (upage));
+
+  p = slab_alloc (&page_cache);
+  if (p == NULL)
+    return NULL;
+  p->upage = upage;
+  p->owner = cur;
+  p->writable = writable;
+  p->frame = NULL;
+  p->swap_slot = SWAP_NONE;
+  p->file = NULL;
+  p->file_ofs = 0;
+  p->read_bytes = 0;
+
+  /* The evictor looks up the owner's pages to find neighbours to
+     write out together, so the table only changes under
+     frame_lock. */
+  lock_acquire (&frame_lock);
+  if (hash_insert (&cur->pages, &p->elem) != NULL)
+    {
+      lock_release (&frame_lock);
+      slab_free (&page_cache, p);
+      return NULL;
+    }
+  lock_release (&frame_lock);
+  return p;
+}
+
+/* Returns the page of thread T that contains VADDR, or a null
+   pointer if T has no such page. */
+struct page *
+page_lookup (struct thread *t, const void *vaddr) 
+{
+  struct page key;
+  struct hash_elem *e;
+
+  key.upage = pg_round_down (vaddr);
+  e = hash_find (&t->pages, &key.elem);
+  return e != NULL ? hash_entry (e, struct page, elem) : NULL;
+}
+
+/* Returns the running process's page containing VADDR.  A page
+   touched for the first time gets its entry from the area that
+   covers it.  Returns a null pointer if no area covers VADDR or
+   memory allocation fails. */
+struct page *
+page_get (const void *vaddr) 
+{
+  struct thread *cur = thread_current ();
+  struct page *p = page_lookup (cur, vaddr);
+  struct vma *v;
+
+  if (p != NULL)
+    return p;
+  v = vma_find (cur, vaddr);
+  if (v == NULL)
+    return NULL;
+
+  p = page_create (pg_round_down (vaddr), v->writable);
+  if (p != NULL && v->type == VMA_FILE)
+    {
+      size_t ofs = (uint8_t *) p->upage - v->start;
+
+      if (v->file_bytes > ofs)
+        {
+          p->file = v->file;
+          p->file_ofs = v->file_ofs + ofs;
+          p->read_bytes = v->file_bytes - ofs;
+          if (p->read_bytes > PGSIZE)
+            p->read_bytes = PGSIZE;
+        }
+    }
+  return p;
+}
+
+/* Removes page P from the running process's page table and frees
+   its frame and swap slot. */
+void
+page_remove (struct page *p) 
+{
+  lock_acquire (&frame_lock);
+  hash_delete (&thread_current ()->pages, &p->elem);
+  page_destroy (&p->elem, NULL);
+  lock_release (&frame_lock);
+}
+
+/* Makes page P resident and keeps it there until page_unpin().
+   Brings the page back from swap or from its file, or zero-fills
+   it, and maps it in the owner's page directory.  A read-only page
+   of an executable uses the frame of another process running the
+   same program if there is one.  Returns the kernel address of its
+   frame, or a null pointer if no frame can be found or the file
+   cannot be read. */
+void *
+page_pin (struct page *p) 
+{
+  return pin (p, lock_held_by_current_thread (filesys_lock), false);
+}
+
+/* Makes page P resident during load(), and returns false if that
+   fails.  A loading process reads its executable without
+   filesys_lock, which its parent holds on its behalf until load()
+   completes (see sys_exec). */
+bool
+page_preload (struct page *p) 
+{
+  if (pin (p, true, false) == NULL)
+    return false;
+  page_unpin (p);
+  return true;
+}
+
+/* Implements page_pin().  FS_LOCKED is true if the caller may use
+   the file system without taking filesys_lock.  FAULT is true if
+   P is brought in to resolve a page fault, which is then
+   counted. */
+static void *
+pin (struct page *p, bool fs_locked, bool fault) 
+{
+  struct page *run[SWAP_CLUSTER];
+  struct frame *frames[SWAP_CLUSTER];
+  size_t run_cnt = 0;
+  bool io;
+  struct frame *f;
+  size_t i;
+
+  lock_acquire (&frame_lock);
+  f = p->frame;
+  if (f != NULL)
+    {
+      f->pinned = true;
+      lock_release (&frame_lock);
+      if (fault)
+        count_fault (false);
+      return f->kpage;
+    }
+
+  /* The page may be mapped to the zero page until it gets a
+     frame. */
+  pagedir_clear_page (p->owner->pagedir, p->upage);
+  if (is_text (p))
+    {
+      f = find_text (p);
+      if (f != NULL)
+        {
+          if (!join (p, f))
+            f = NULL;
+          lock_release (&frame_lock);
+          if (f != NULL && fault)
+            count_fault (false);
+          return f != NULL ? f->kpage : NULL;
+        }
+    }
+  f = frame_alloc (p);
+  if (f != NULL && p->swap_slot != SWAP_NONE)
+    run_cnt = gather_run (p, f, run, frames);
+  lock_release (&frame_lock);
+  if (f == NULL)
+    return NULL;
+
+  /* The new frames are pinned and not yet mapped, so no other
+     thread looks at them while the (possibly slow) read runs.
+     Swap copies are kept while the pages stay clean, so an
+     unmodified page can later be evicted without a write. */
+  if (run_cnt > 0)
+    {
+      void *kpages[SWAP_CLUSTER];
+
+      for (i = 0; i < run_cnt; i++)
+        kpages[i] = frames[i]->kpage;
+      io = swap_read_run (run[0]->swap_slot, run_cnt, kpages) > 0;
+      page_swap_in_cnt += run_cnt;
+      page_read_ahead_cnt += run_cnt - 1;
+    }
+  else
+    {
+      if (!fill (p, f->kpage, fs_locked))
+        {
+          lock_acquire (&frame_lock);
+          frame_free (f);
+          lock_release (&frame_lock);
+          return NULL;
+        }
+      io = p->read_bytes > 0;
+      run[0] = p;
+      frames[0] = f;
+      run_cnt = 1;
+    }
+
+  /* Pages read ahead are left unpinned and not accessed, so they
+     are the first to go again if the process does not touch
+     them. */
+  lock_acquire (&frame_lock);
+  if (is_text (p))
+    {
+      /* Another process may have read the same page meanwhile. */
+      struct frame *other = find_text (p);
+
+      if (other != NULL)
+        {
+          frame_free (f);
+          if (!join (p, other))
+            other = NULL;
+          lock_release (&frame_lock);
+          if (other != NULL && fault)
+            count_fault (io);
+          return other != NULL ? other->kpage : NULL;
+        }
+      frame_add_text (f, file_get_inode (p->file), p->file_ofs,
+                      p->read_bytes);
+    }
+  for (i = 0; i < run_cnt; i++)
+    {
+      struct page *q = run[i];
+
+      if (!pagedir_set_page (q->owner->pagedir, q->upage,
+                             frames[i]->kpage, q->writable))
+        {
+          frame_free (frames[i]);
+          if (q == p)
+            f = NULL;
+          continue;
+        }
+      q->frame = frames[i];
+      if (q != p)
+        frames[i]->pinned = false;
+    }
+  lock_release (&frame_lock);
+  if (f != NULL && fault)
+    count_fault (io);
+  return f != NULL ? f->kpage : NULL;
+}
+
+/* Collects in RUN, in slot order, the pages to be read from swap
+   together with page P, which has just been given frame F: the
+   longest run of P's neighbours in the same cluster that are not
+   resident, sit in the slots that follow on from P's, and for
+   which a free frame is at hand.  Read-ahead never evicts.  Stores
+   each page's frame in FRAMES and returns the number of pages in
+   RUN.  The caller must hold frame_lock. */
+static size_t
+gather_run (struct page *p, struct frame *f,
+            struct page *run[], struct frame *frames[]) 
+{
+  size_t index = pg_no (p->upage) % SWAP_CLUSTER;
+  uint8_t *group = (uint8_t *) p->upage - index * PGSIZE;
+  size_t base = p->swap_slot - index;
+  struct frame *got[SWAP_CLUSTER];
+  size_t lo = index, hi = index;
+  size_t i;
+
+  got[index] = f;
+  if (page_swap_cluster && p->swap_slot % SWAP_CLUSTER == index)
+    {
+      while (lo > 0
+             && (got[lo - 1] = read_ahead_frame (p->owner, group,
+                                                 lo - 1, base)) != NULL)
+        lo--;
+      while (hi < SWAP_CLUSTER - 1
+             && (got[hi + 1] = read_ahead_frame (p->owner, group,
+                                                 hi + 1, base)) != NULL)
+        hi++;
+    }
+
+  for (i = lo; i <= hi; i++)
+    {
+      run[i - lo] = frame_page (list_begin (&got[i]->pages));
+      frames[i - lo] = got[i];
+    }
+  return hi - lo + 1;
+}
+
+/* Returns a pinned free frame for the page at index I of GROUP in
+   T's address space, if that page is not resident and its copy is
+   in swap-slot BASE + I.  Otherwise, or if no frame is free,
+   returns a null pointer. */
+static struct frame *
+read_ahead_frame (struct thread *t, uint8_t *group, size_t i, size_t base) 
+{
+  struct page *q = page_lookup (t, group + i * PGSIZE);
+
+  if (q == NULL || q->frame != NULL || q->swap_slot != base + i)
+    return NULL;
+  return frame_try_alloc (q);
+}
+
+/* Reads the contents of page P, which is not in swap, into KPAGE.
+   Returns false if its file is shorter than expected. */
+static bool
+fill (struct page *p, void *kpage, bool fs_locked) 
+{
+  if (p->read_bytes > 0)
+    {
+      off_t read;
+
+      if (!fs_locked)
+        lock_acquire (filesys_lock);
+      read = file_read_at (p->file, kpage, p->read_bytes, p->file_ofs);
+      if (!fs_locked)
+        lock_release (filesys_lock);
+      if (read != (off_t) p->read_bytes)
+        return false;
+      page_file_in_cnt++;
+    }
+  memset ((uint8_t *) kpage + p->read_bytes, 0, PGSIZE - p->read_bytes);
+  return true;
+}
+
+/* Allows page P, which must be resident, to be evicted again. */
+void
+page_unpin (struct page *p) 
+{
+  ASSERT (p->frame != NULL);
+
+  p->frame->pinned = false;
+}
+
+/* Brings in the running process's page containing FAULT_ADDR,
+   for writing if WRITE is true.  A page that holds nothing but
+   zeros is only mapped to the zero page when read.  A read also
+   maps the pages around it that are already in memory (see
+   fault_around()).  Returns false if no area of the process
+   covers it. */
+bool
+page_in (const void *fault_addr, bool write) 
+{
+  struct page *p = page_get (fault_addr);
+
+  if (p == NULL)
+    return false;
+  if (!write && map_zero (p))
+    count_fault (false);
+  else
+    {
+      if (pin (p, lock_held_by_current_thread (filesys_lock), true) == NULL)
+        return false;
+      page_unpin (p);
+    }
+  if (!write)
+    fault_around (p);
+  return true;
+}
+
+/* Maps in the pages of the running process around page P, which
+   has just been faulted in for reading, that need no I/O: pages
+   of read-only areas whose contents another process running the
+   same program has in a frame, and pages of any area that are all
+   zeros.  They are mapped read-only, the zero pages to the zero
+   page until their first write, so a process walking through its
+   code or data sequentially takes one fault per PAGE_FAULT_AROUND
+   pages instead of one per page. */
+static void
+fault_around (struct page *p) 
+{
+  struct thread *cur = thread_current ();
+  uint8_t *start;
+  int i;
+
+  if (page_fault_around <= 1)
+    return;
+
+  start = (uint8_t *) p->upage
+          - (pg_no (p->upage) % page_fault_around) * PGSIZE;
+  for (i = 0; i < page_fault_around; i++)
+    {
+      uint8_t *upage = start + i * PGSIZE;
+      struct vma *v;
+      struct page *q;
+
+      if (upage == p->upage || !is_user_vaddr (upage))
+        continue;
+      v = vma_find (cur, upage);
+      if (v == NULL)
+        continue;
+
+      /* A writable page can only be mapped if it is zeros. */
+      if (v->writable && v->type == VMA_FILE
+          && (size_t) (upage - v->start) < v->file_bytes)
+        continue;
+      q = page_get (upage);
+      if (q == NULL)
+        continue;
+
+      if (is_text (q))
+        {
+          struct frame *f;
+
+          lock_acquire (&frame_lock);
+          f = q->frame == NULL ? find_text (q) : NULL;
+          if (f != NULL)
+            {
+              /* join() pins the frame for its caller. */
+              bool pinned = f->pinned;
+
+              join (q, f);
+              f->pinned = pinned;
+            }
+          lock_release (&frame_lock);
+        }
+      else
+        map_zero (q);
+    }
+}
+
+/* Counts a page fault, as major if resolving it read from the
+   swap device or a file, and as minor if it did not, even if it
+   decompressed the page from the swap cache. */
+static void
+count_fault (bool major) 
+{
+  if (major)
+    page_major_fault_cnt++;
+  else
+    page_minor_fault_cnt++;
+}
+
+/* Maps page P read-only to the zero page if it has no frame and
+   its contents are all zeros, that is, if it has never been
+   written out and has nothing to read from its file.  Its first
+   write then faults into page_cow(), which gives it a frame.
+   Returns false if P is not such a page or memory allocation
+   fails. */
+static bool
+map_zero (struct page *p) 
+{
+  bool success;
+
+  if (p->read_bytes != 0 || p->swap_slot != SWAP_NONE)
+    return false;
+
+  lock_acquire (&frame_lock);
+  success = (p->frame == NULL
+             && pagedir_get_page (p->owner->pagedir, p->upage) == NULL
+             && pagedir_set_page (p->owner->pagedir, p->upage,
+                                  zero_kpage, false));
+  if (success)
+    page_zero_cnt++;
+  lock_release (&frame_lock);
+  return success;
+}
+
+/* Handles a write fault on the running process's page at
+   FAULT_ADDR, which is mapped read-only because it shares its
+   frame with other processes since fork(), or because it is
+   mapped to the zero page.  The page gets a
+   private, writable copy of the frame, or the frame itself if no
+   other page holds it any more.  Returns false if there is no such
+   page or no frame for the copy. */
+bool
+page_cow (const void *fault_addr) 
+{
+  struct page *p = page_lookup (thread_current (), fault_addr);
+  struct frame *f, *copy;
+  uint32_t *pd;
+  bool pinned;
+
+  if (p == NULL || !p->writable)
+    return false;
+  pd = p->owner->pagedir;
+
+  lock_acquire (&frame_lock);
+  f = p->frame;
+  if (f == NULL)
+    {
+      /* Mapped to the zero page, or evicted since the fault.  It
+         comes back private. */
+      lock_release (&frame_lock);
+      return page_in (fault_addr, true);
+    }
+  if (!shared (f))
+    {
+      /* No other process may find the frame once it is written. */
+      frame_forget_text (f);
+      pagedir_set_writable (pd, p->upage, true);
+      lock_release (&frame_lock);
+      count_fault (false);
+      return true;
+    }
+
+  /* Take P off F before finding it a frame of its own, and keep F
+     while it is copied.  F may be pinned by another of its
+     pages' owners. */
+  pinned = f->pinned;
+  f->pinned = true;
+  pagedir_clear_page (pd, p->upage);
+  if (pagedir_is_dirty (pd, p->upage))
+    f->dirty = true;
+  list_remove (&p->frame_elem);
+  p->frame = NULL;
+
+  copy = frame_alloc (p);
+  if (copy == NULL)
+    {
+      list_push_back (&f->pages, &p->frame_elem);
+      pagedir_set_page (pd, p->upage, f->kpage, false);
+      p->frame = f;
+      f->pinned = pinned;
+      lock_release (&frame_lock);
+      return false;
+    }
+  memcpy (copy->kpage, f->kpage, PGSIZE);
+  copy->dirty = f->dirty;
+  f->pinned = pinned;
+
+  pagedir_set_page (pd, p->upage, copy->kpage, true);
+  p->frame = copy;
+  copy->pinned = false;
+  page_cow_cnt++;
+  lock_release (&frame_lock);
+  count_fault (false);
+  return true;
+}
+
+/* Unmaps frame F from the pages it holds so that it can be
+   reused, writing it to swap if it was modified.  Pages that
+   shared the frame share the swap slot.  A clean frame can be
+   rebuilt from its pages' swap slot, file or zeros, and is simply
+   dropped.  Returns false, leaving F mapped, if swap is full.
+   The caller must hold frame_lock. */
+bool
+page_evict (struct frame *f) 
+{
+  struct page *first = frame_page (list_begin (&f->pages));
+  bool dirty = f->dirty;
+  struct list_elem *e;
+
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+
+  /* Unmap first, so that no owner can change the page while it is
+     being written out. */
+  for (e = list_begin (&f->pages); e != list_end (&f->pages);
+       e = list_next (e))
+    {
+      struct page *p = frame_page (e);
+
+      pagedir_clear_page (p->owner->pagedir, p->upage);
+      if (pagedir_is_dirty (p->owner->pagedir, p->upage))
+        dirty = true;
+    }
+
+  if (dirty && !shared (f) && page_swap_cluster && write_cluster (first))
+    return true;
+  if (dirty)
+    {
+      size_t slot;
+
+      /* The old copies are stale; free them before looking for
+         room. */
+      for (e = list_begin (&f->pages); e != list_end (&f->pages);
+           e = list_next (e))
+        {
+          struct page *p = frame_page (e);
+
+          if (p->swap_slot != SWAP_NONE)
+            {
+              swap_drop (p->swap_slot);
+              p->swap_slot = SWAP_NONE;
+            }
+        }
+      slot = swap_out (f->kpage);
+      if (slot == BITMAP_ERROR)
+        {
+          bool writable = !shared (f);
+
+          for (e = list_begin (&f->pages); e != list_end (&f->pages);
+               e = list_next (e))
+            {
+              struct page *p = frame_page (e);
+
+              pagedir_set_page (p->owner->pagedir, p->upage, f->kpage,
+                                p->writable && writable);
+            }
+          f->dirty = true;
+          return false;
+        }
+      for (e = list_begin (&f->pages); e != list_end (&f->pages);
+           e = list_next (e))
+        {
+          struct page *p = frame_page (e);
+
+          if (p != first)
+            swap_share (slot);
+          p->swap_slot = slot;
+        }
+      page_swap_out_cnt++;
+      page_swap_write_cnt++;
+    }
+
+  for (e = list_begin (&f->pages); e != list_end (&f->pages);
+       e = list_next (e))
+    frame_page (e)->frame = NULL;
+  return true;
+}
+
+/* Writes page P, which page_evict() has just unmapped, to the slot
+   of its cluster that matches its place among its neighbours.
+   Neighbours in the same cluster that the clock would soon evict
+   anyway (resident, unpinned, dirty and not recently accessed) go
+   with it, in as few requests as their slots allow, and their
+   frames are freed.  A cluster the neighbours already use is
+   preferred over a fresh one.  Returns false if no slot in a
+   cluster can be found for P, leaving P as it was. */
+static bool
+write_cluster (struct page *p) 
+{
+  struct thread *t = p->owner;
+  uint32_t *pd = t->pagedir;
+  size_t index = pg_no (p->upage) % SWAP_CLUSTER;
+  uint8_t *group = (uint8_t *) p->upage - index * PGSIZE;
+  struct page *batch[SWAP_CLUSTER];
+  size_t base = BITMAP_ERROR;
+  size_t i, start;
+
+  for (i = 0; i < SWAP_CLUSTER; i++)
+    {
+      struct page *q = page_lookup (t, group + i * PGSIZE);
+
+      batch[i] = NULL;
+      if (q == NULL)
+        continue;
+      if (base == BITMAP_ERROR && q->swap_slot != SWAP_NONE
+          && q->swap_slot % SWAP_CLUSTER == i)
+        base = q->swap_slot - i;
+      if (q == p
+          || (q->frame != NULL && !q->frame->pinned && !shared (q->frame)
+              && !pagedir_is_accessed (pd, q->upage)
+              && (q->frame->dirty || pagedir_is_dirty (pd, q->upage))))
+        batch[i] = q;
+    }
+
+  /* Place P first.  Its old copy is stale, but may be in the very
+     slot it is about to get, unless a process forked from this one
+     still shares that. */
+  if (base == BITMAP_ERROR || p->swap_slot != base + index
+      || swap_shared (p->swap_slot))
+    {
+      if (p->swap_slot != SWAP_NONE)
+        {
+          swap_drop (p->swap_slot);
+          p->swap_slot = SWAP_NONE;
+        }
+      if (base == BITMAP_ERROR || !swap_claim (base + index))
+        {
+          size_t slot = swap_claim_cluster (index);
+          if (slot == BITMAP_ERROR)
+            return false;
+          base = slot - index;
+        }
+      p->swap_slot = base + index;
+    }
+
+  /* Then the neighbours that can follow it, each unmapped only once
+     it has a slot. */
+  for (i = 0; i < SWAP_CLUSTER; i++)
+    {
+      struct page *q = batch[i];
+
+      if (q == NULL || q == p)
+        continue;
+      if (q->swap_slot != base + i || swap_shared (q->swap_slot))
+        {
+          if (q->swap_slot != SWAP_NONE)
+            {
+              swap_drop (q->swap_slot);
+              q->swap_slot = SWAP_NONE;
+            }
+          if (!swap_claim (base + i))
+            {
+              batch[i] = NULL;
+              continue;
+            }
+          q->swap_slot = base + i;
+        }
+      pagedir_clear_page (pd, q->upage);
+    }
+
+  /* Write each run of consecutive slots with one request. */
+  for (start = 0; start < SWAP_CLUSTER; start = i)
+    {
+      const void *kpages[SWAP_CLUSTER];
+      size_t cnt = 0;
+
+      for (i = start; i < SWAP_CLUSTER && batch[i] != NULL; i++)
+        kpages[cnt++] = batch[i]->frame->kpage;
+      if (cnt == 0)
+        {
+          i++;
+          continue;
+        }
+      swap_write_run (base + start, cnt, kpages);
+      page_swap_out_cnt += cnt;
+      page_swap_write_cnt++;
+    }
+
+  for (i = 0; i < SWAP_CLUSTER; i++)
+    {
+      struct page *q = batch[i];
+
+      if (q != NULL && q != p)
+        {
+          frame_free (q->frame);
+          q->frame = NULL;
+          frame_evict_cnt++;
+        }
+    }
+  p->frame = NULL;
+  return true;
+}
+
+/* Returns a hash value for page P. */
+static unsigned
+page_hash (const struct hash_elem *p_, void *aux UNUSED) 
+{
+  const struct page *p = hash_entry (p_, struct page, elem);
+  return hash_int (pg_no (p->upage));
+}
+
+/* Returns true if page A precedes page B. */
+static bool
+page_less (const struct hash_elem *a_, const struct hash_elem *b_,
+           void *aux UNUSED) 
+{
+  const struct page *a = hash_entry (a_, struct page, elem);
+  const struct page *b = hash_entry (b_, struct page, elem);
+  return a->upage < b->upage;
+}
+
+/* Frees page P_ and whatever holds its contents. */
+static void
+page_destroy (struct hash_elem *p_, void *aux UNUSED) 
+{
+  struct page *p = hash_entry (p_, struct page, elem);
+
+  if (p->frame != NULL)
+    {
+      struct frame *f = p->frame;
+      uint32_t *pd = p->owner->pagedir;
+
+      /* Pages still sharing the frame must know if it was
+         modified. */
+      pagedir_clear_page (pd, p->upage);
+      if (pagedir_is_dirty (pd, p->upage))
+        f->dirty = true;
+      list_remove (&p->frame_elem);
+      if (list_empty (&f->pages))
+        frame_free (f);
+    }
+  else
+    {
+      /* The page directory would free the zero page with the
+         pages it maps. */
+      pagedir_clear_page (p->owner->pagedir, p->upage);
+    }
+  if (p->swap_slot != SWAP_NONE)
+    swap_drop (p->swap_slot);
+  slab_free (&page_cache, p);
+}
+
+/* Returns true if page P is a read-only page of an executable
+   that has never been written to swap, whose frame can therefore
+   be shared by every process running the same program. */
+static bool
+is_text (const struct page *p) 
+{
+  return !p->writable && p->file != NULL && p->swap_slot == SWAP_NONE;
+}
+
+/* Returns the frame that holds the contents of page P, a
+   read-only page of an executable, for another process, or a
+   null pointer if there is none.  The caller must hold
+   frame_lock. */
+static struct frame *
+find_text (struct page *p) 
+{
+  struct frame *f = frame_find_text (file_get_inode (p->file),
+                                     p->file_ofs);
+
+  /* A page that the next segment starts in reads more of the
+     file. */
+  if (f == NULL || f->read_bytes != p->read_bytes)
+    return NULL;
+  return f;
+}
+
+/* Adds page P to frame F, which holds the same contents, and maps
+   it read-only.  The frame is returned pinned.  Returns false if
+   memory allocation fails.  The caller must hold frame_lock. */
+static bool
+join (struct page *p, struct frame *f) 
+{
+  if (!pagedir_set_page (p->owner->pagedir, p->upage, f->kpage, false))
+    return false;
+  list_push_back (&f->pages, &p->frame_elem);
+  p->frame = f;
+  f->pinned = true;
+  page_text_share_cnt++;
+  return true;
+}
+
+/* Returns true if frame F holds more than one page. */
+static bool
+shared (struct frame *f) 
+{
+  return list_begin (&f->pages) != list_rbegin (&f->pages);
+}
+
+/* Returns the page whose frame_elem is E. */
+static struct page *
+frame_page (struct list_elem *e) 
+{
+  return list_entry (e, struct page, frame_elem);
+}
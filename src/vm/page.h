@@ -0,0 +1,88 @@
+#ifndef VM_PAGE_H
+#define VM_PAGE_H
+
+#include <hash.h>
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "filesys/off_t.h"
+
+struct frame;
+struct thread;
+
+/* Swap slot of a page that has no copy in swap. */
+#define SWAP_NONE ((size_t) -1)
+
+/* A page of a process's virtual address space: an entry in the
+   supplemental page table that says where the page's contents
+   live when it is not in a frame.
+
+   A page that is not resident comes back from its swap slot if it
+   has one.  Otherwise it has never been modified, and is rebuilt
+   from its first READ_BYTES bytes of FILE at FILE_OFS followed by
+   zeros. */
+struct page
+  {
+    void *upage;                /* User virtual address. */
+    struct thread *owner;       /* Process whose page this is. */
+    bool writable;              /* Writable by the process? */
+    struct frame *frame;        /* Frame holding the page, or null. */
+    size_t swap_slot;           /* Copy in swap, or SWAP_NONE. */
+    struct file *file;          /* Backing file, or null. */
+    off_t file_ofs;             /* Offset of the page in FILE. */
+    size_t read_bytes;          /* Bytes read from FILE. */
+    struct hash_elem elem;      /* Element in owner's page table. */
+    struct list_elem frame_elem; /* Element in frame's page list. */
+  };
+
+/* Pages written to and read back from swap, requests made to
+   write them, and pages read back before they were touched. */
+extern long long page_swap_out_cnt;
+extern long long page_swap_in_cnt;
+extern long long page_swap_write_cnt;
+extern long long page_read_ahead_cnt;
+
+/* Pages read from their backing file. */
+extern long long page_file_in_cnt;
+
+/* Pages copied on a write after fork(). */
+extern long long page_cow_cnt;
+
+/* Pages of executables mapped to a frame that another process
+   running the same program had already read. */
+extern long long page_text_share_cnt;
+
+/* Pages mapped to the zero page because they were read before
+   being written. */
+extern long long page_zero_cnt;
+
+/* Page faults resolved without I/O and with it. */
+extern long long page_minor_fault_cnt;
+extern long long page_major_fault_cnt;
+
+/* Read executables in at load time rather than on first touch. */
+extern bool page_eager_load;
+
+/* Keep neighbouring pages together in swap. */
+extern bool page_swap_cluster;
+
+/* Pages around a read fault mapped in with it. */
+extern int page_fault_around;
+
+void page_init (void);
+bool page_table_init (struct hash *);
+void page_table_destroy (void);
+bool page_table_copy (struct thread *parent);
+
+struct page *page_create (void *upage, bool writable);
+struct page *page_lookup (struct thread *, const void *vaddr);
+struct page *page_get (const void *vaddr);
+void page_remove (struct page *);
+void *page_pin (struct page *);
+bool page_preload (struct page *);
+void page_unpin (struct page *);
+bool page_in (const void *fault_addr, bool write);
+bool page_cow (const void *fault_addr);
+bool page_evict (struct frame *);
+
+#endif /* vm/page.h */
@@ -0,0 +1,272 @@
+#include "vm/vma.h"
+#include <debug.h>
+#include "threads/slab.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "vm/page.h"
+
+/* How far below the stack pointer an access may fault and still
+   count as a stack access: PUSHA stores 32 bytes below %esp before
+   moving it. */
+#define STACK_SLACK 32
+
+/* Largest size of a user stack, in bytes.  Set with the
+   -stack-limit kernel option. */
+size_t vma_stack_limit = 8 * 1024 * 1024;
+
+/* Storage for struct vma. */
+static struct slab_cache vma_cache;
+
+static rb_less_func vma_less;
+static rb_action_func vma_free;
+static void advance (struct vma *, uint8_t *start);
+
+/* Initializes the area allocator. */
+void
+vma_init (void) 
+{
+  slab_cache_init (&vma_cache, "vma", sizeof (struct vma), NULL);
+}
+
+/* Initializes VMAS as an empty area tree. */
+void
+vma_table_init (struct rb_tree *vmas) 
+{
+  rb_init (vmas, vma_less, NULL);
+}
+
+/* Frees every area of the running process.  Its pages must
+   already have been released with page_table_destroy(). */
+void
+vma_table_destroy (void) 
+{
+  rb_clear (&thread_current ()->vmas, vma_free);
+}
+
+/* Gives the running process, which is being created by fork(), a
+   copy of each of PARENT's areas.  Each file-backed area is backed
+   by the file that FILE_FUNC, given AUX, returns for the parent's.
+   Returns false if memory allocation fails. */
+bool
+vma_table_copy (struct thread *parent, vma_file_func *file_func, void *aux) 
+{
+  struct rb_tree *vmas = &thread_current ()->vmas;
+  struct rb_elem *e;
+
+  for (e = rb_first (&parent->vmas); e != NULL; e = rb_next (e)) 
+    {
+      struct vma *v = rb_entry (e, struct vma, elem);
+      struct vma *copy = slab_alloc (&vma_cache);
+
+      if (copy == NULL)
+        return false;
+      *copy = *v;
+      if (copy->file != NULL)
+        copy->file = file_func (v->file, aux);
+      rb_insert (vmas, &copy->elem);
+    }
+  return true;
+}
+
+/* Adds an area of SIZE bytes at START to the running process.
+   START and SIZE must be page-aligned.  For VMA_FILE, the area's
+   first FILE_BYTES bytes come from FILE starting at FILE_OFS.
+   Returns the new area, or a null pointer if the range overlaps
+   an existing area or memory allocation fails. */
+struct vma *
+vma_map (void *start, size_t size, enum vma_type type, bool writable,
+         struct file *file, off_t file_ofs, size_t file_bytes) 
+{
+  struct vma *v;
+
+  ASSERT (pg_ofs (start) == 0);
+  ASSERT (pg_ofs ((void *) size) == 0);
+  ASSERT (size > 0);
+  ASSERT (type == VMA_FILE || file == NULL);
+
+  if (!is_user_vaddr ((uint8_t *) start + size - 1)
+      || (uint8_t *) start + size < (uint8_t *) start)
+    return NULL;
+
+  v = slab_alloc (&vma_cache);
+  if (v == NULL)
+    return NULL;
+  v->start = start;
+  v->end = v->start + size;
+  v->writable = writable;
+  v->type = type;
+  v->file = file;
+  v->file_ofs = file_ofs;
+  v->file_bytes = type == VMA_FILE ? file_bytes : 0;
+
+  if (rb_insert (&thread_current ()->vmas, &v->elem) != NULL)
+    {
+      slab_free (&vma_cache, v);
+      return NULL;
+    }
+  return v;
+}
+
+/* Removes SIZE bytes at START, which must be page-aligned, from
+   the running process's address space, releasing every page in
+   the range.  Areas that straddle either end of the range are
+   trimmed to what lies outside it.  Returns false, leaving the
+   address space unchanged, if memory allocation fails. */
+bool
+vma_unmap (void *start_, size_t size) 
+{
+  struct rb_tree *vmas = &thread_current ()->vmas;
+  uint8_t *start = start_;
+  uint8_t *end = start + size;
+  struct vma *outer, *spare = NULL;
+  struct vma key;
+  struct rb_elem *e;
+
+  ASSERT (pg_ofs (start) == 0);
+  ASSERT (pg_ofs ((void *) size) == 0);
+
+  if (size == 0)
+    return true;
+
+  /* Only an area that reaches past both ends of the range is split
+     in two, and then it is the only area in the range.  Allocate
+     its second half before anything is removed. */
+  outer = vma_find (thread_current (), start);
+  if (outer != NULL && outer->start < start && end < outer->end)
+    {
+      spare = slab_alloc (&vma_cache);
+      if (spare == NULL)
+        return false;
+    }
+
+  key.start = start;
+  key.end = end;
+  while ((e = rb_find (vmas, &key.elem)) != NULL) 
+    {
+      struct vma *v = rb_entry (e, struct vma, elem);
+      uint8_t *lo = v->start > start ? v->start : start;
+      uint8_t *hi = v->end < end ? v->end : end;
+      struct vma *tail = NULL;
+      uint8_t *upage;
+
+      /* Unmapping the middle of an area leaves two areas. */
+      if (v->start < lo && hi < v->end)
+        {
+          ASSERT (spare != NULL);
+          tail = spare;
+          spare = NULL;
+          *tail = *v;
+          advance (tail, hi);
+        }
+
+      rb_remove (vmas, e);
+      for (upage = lo; upage < hi; upage += PGSIZE) 
+        {
+          struct page *p = page_lookup (thread_current (), upage);
+          if (p != NULL)
+            page_remove (p);
+        }
+
+      if (tail != NULL)
+        {
+          v->end = lo;
+          rb_insert (vmas, &v->elem);
+          rb_insert (vmas, &tail->elem);
+        }
+      else if (v->start < lo)
+        {
+          v->end = lo;
+          rb_insert (vmas, &v->elem);
+        }
+      else if (hi < v->end)
+        {
+          advance (v, hi);
+          rb_insert (vmas, &v->elem);
+        }
+      else
+        slab_free (&vma_cache, v);
+    }
+  return true;
+}
+
+/* Returns the area of thread T that contains VADDR, or a null
+   pointer if VADDR is not in any of T's areas. */
+struct vma *
+vma_find (struct thread *t, const void *vaddr) 
+{
+  struct vma key = { .start = (uint8_t *) vaddr };
+  struct rb_elem *e;
+
+  key.end = key.start + 1;
+  e = rb_find (&t->vmas, &key.elem);
+  return e != NULL ? rb_entry (e, struct vma, elem) : NULL;
+}
+
+/* Extends the running process's stack area down to the page
+   holding VADDR, if VADDR looks like a stack access for user
+   stack pointer ESP: at or above ESP less the PUSHA slack, and
+   within vma_stack_limit of the top of user memory.  Only the
+   area grows; its new pages are zero-filled when first touched.
+   Returns true if VADDR is now in the stack area. */
+bool
+vma_grow_stack (const void *vaddr, const void *esp) 
+{
+  struct thread *cur = thread_current ();
+  uint8_t *upage = pg_round_down (vaddr);
+  struct vma *stack, key;
+
+  if (!is_user_vaddr (vaddr)
+      || (const uint8_t *) vaddr + STACK_SLACK < (const uint8_t *) esp
+      || (size_t) ((uint8_t *) PHYS_BASE - upage) > vma_stack_limit)
+    return false;
+
+  stack = vma_find (cur, (uint8_t *) PHYS_BASE - 1);
+  if (stack == NULL || stack->type != VMA_STACK)
+    return false;
+  if (upage >= stack->start)
+    return true;
+
+  /* The stack may not grow into another area.  Otherwise moving
+     its start leaves the tree's order intact. */
+  key.start = upage;
+  key.end = stack->start;
+  if (rb_find (&cur->vmas, &key.elem) != NULL)
+    return false;
+  stack->start = upage;
+  return true;
+}
+
+/* Moves the start of area V forward to START, keeping the file
+   contents of the part that remains at the same addresses. */
+static void
+advance (struct vma *v, uint8_t *start) 
+{
+  size_t skip = start - v->start;
+
+  v->start = start;
+  if (v->type == VMA_FILE)
+    {
+      v->file_ofs += skip;
+      v->file_bytes = v->file_bytes > skip ? v->file_bytes - skip : 0;
+    }
+}
+
+/* Returns true if area A lies entirely below area B.  Areas
+   never overlap, so overlapping ranges compare equal, which lets
+   rb_find() look up the area holding an address. */
+static bool
+vma_less (const struct rb_elem *a_, const struct rb_elem *b_,
+          void *aux UNUSED) 
+{
+  const struct vma *a = rb_entry (a_, struct vma, elem);
+  const struct vma *b = rb_entry (b_, struct vma, elem);
+
+  return a->end <= b->start;
+}
+
+/* Frees area V_. */
+static void
+vma_free (struct rb_elem *v_, void *aux UNUSED) 
+{
+  slab_free (&vma_cache, rb_entry (v_, struct vma, elem));
+}
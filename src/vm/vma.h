@@ -0,0 +1,56 @@
+#ifndef VM_VMA_H
+#define VM_VMA_H
+
+#include <rbtree.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "filesys/off_t.h"
+
+struct thread;
+
+/* What backs the pages of a virtual memory area. */
+enum vma_type
+  {
+    VMA_FILE,                   /* Read from a file, then zeros. */
+    VMA_ANON,                   /* Zeros. */
+    VMA_STACK                   /* Zeros; the user stack. */
+  };
+
+/* A virtual memory area: a page-aligned range of a process's
+   address space whose pages share a protection and a backing.
+   Each process keeps its areas in a tree ordered by address.
+   A page gets its supplemental page table entry from its area
+   the first time it is touched. */
+struct vma
+  {
+    uint8_t *start;             /* First address. */
+    uint8_t *end;               /* One past the last address. */
+    bool writable;              /* Writable by the process? */
+    enum vma_type type;         /* Backing. */
+    struct file *file;          /* VMA_FILE: backing file. */
+    off_t file_ofs;             /* VMA_FILE: offset of START in FILE. */
+    size_t file_bytes;          /* VMA_FILE: bytes of FILE from START;
+                                   the rest of the area is zeros. */
+    struct rb_elem elem;        /* Element in owner's area tree. */
+  };
+
+/* Returns a child process's counterpart of its parent's FILE. */
+typedef struct file *vma_file_func (struct file *, void *aux);
+
+/* Largest size of a user stack, in bytes. */
+extern size_t vma_stack_limit;
+
+void vma_init (void);
+void vma_table_init (struct rb_tree *);
+void vma_table_destroy (void);
+bool vma_table_copy (struct thread *parent, vma_file_func *, void *aux);
+
+struct vma *vma_map (void *start, size_t size, enum vma_type,
+                     bool writable, struct file *, off_t file_ofs,
+                     size_t file_bytes);
+bool vma_unmap (void *start, size_t size);
+struct vma *vma_find (struct thread *, const void *vaddr);
+bool vma_grow_stack (const void *vaddr, const void *esp);
+
+#endif /* vm/vma.h */
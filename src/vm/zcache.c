@@ -0,0 +1,299 @@
+#include "vm/zcache.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <lz.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Compressed cache in front of the swap device.
+
+   Pages written to swap are compressed into a region of memory,
+   and go to the device only when the region has no room for
+   them.  A page of zeros takes no room at all.  The cache is
+   indexed by swap-slot, so a page keeps the slot it would have
+   had on the device, and swap.c consults the cache before
+   touching the device.
+
+   The region grows a page at a time as pages are swapped out,
+   up to zcache_percent percent of the size of the user pool, and
+   gives back each page that empties, so a system that never
+   swaps pays nothing for it.  Region pages come from the kernel
+   pool, since the cache fills up just when the user pool has run
+   out; if the kernel pool has no page to spare, the page goes to
+   the device. */
+
+/* Allocation unit within the region, in bytes. */
+#define CHUNK_SIZE 64
+
+/* Chunks in a region page.  In CHUNK_MAP each page's chunks are
+   followed by one that is always in use, so that no run of free
+   chunks spans two pages, which need not be adjacent. */
+#define PAGE_CHUNKS (PGSIZE / CHUNK_SIZE)
+#define PAGE_STRIDE (PAGE_CHUNKS + 1)
+
+/* What a slot holds in the cache. */
+enum entry_state
+  {
+    ENTRY_NONE,                 /* Nothing; the slot is on the device. */
+    ENTRY_ZERO,                 /* A page of zeros. */
+    ENTRY_DATA                  /* SIZE bytes at CHUNK. */
+  };
+
+/* A slot's entry.  A page that does not compress is kept as is,
+   with SIZE equal to PGSIZE. */
+struct entry
+  {
+    uint8_t state;              /* An enum entry_state. */
+    uint16_t size;              /* Bytes of data. */
+    uint32_t chunk;             /* First chunk of data. */
+  };
+
+unsigned zcache_percent = 20;
+
+static struct lock zcache_lock;
+static struct entry *entries;   /* One per swap-slot, or null if off. */
+static uint8_t **region;        /* Pages holding compressed data,
+                                   null where not allocated. */
+static size_t region_pages;     /* Most pages REGION may hold. */
+static size_t used_pages;       /* Pages REGION holds. */
+static size_t used_chunks;      /* Chunks holding data. */
+static struct bitmap *chunk_map; /* Chunks of REGION in use. */
+
+/* Scratch space for compression, guarded by zcache_lock. */
+static uint8_t scratch[PGSIZE];
+static uint16_t lz_work[LZ_WORK_SIZE / sizeof (uint16_t)];
+
+/* Statistics. */
+static long long store_cnt;     /* Pages taken in. */
+static long long zero_cnt;      /* ...of which were zeros. */
+static long long spill_cnt;     /* Pages left to the device. */
+static long long hit_cnt;       /* Loads served from the cache. */
+static long long miss_cnt;      /* Loads left to the device. */
+static long long data_bytes;    /* Bytes stored for pages taken in. */
+
+static void release (struct entry *);
+static bool grow (void);
+static uint8_t *chunk_data (size_t chunk);
+static bool is_zero (const void *page);
+
+/* Sets up the cache for a swap device of SLOT_CNT slots, letting
+   it grow to zcache_percent percent of the size of the user pool.
+   If that is nothing, every page goes to the device. */
+void
+zcache_init (size_t slot_cnt) 
+{
+  lock_init (&zcache_lock);
+  region_pages = palloc_user_pages () * zcache_percent / 100;
+  if (slot_cnt == 0 || region_pages == 0)
+    return;
+
+  /* No page is there yet, so every chunk is in use. */
+  region = calloc (region_pages, sizeof *region);
+  chunk_map = bitmap_create (region_pages * PAGE_STRIDE);
+  entries = calloc (slot_cnt, sizeof *entries);
+  if (region == NULL || chunk_map == NULL || entries == NULL)
+    PANIC ("couldn't allocate swap cache");
+  bitmap_set_all (chunk_map, true);
+}
+
+/* Takes a copy of PAGE, which is about to be written to
+   swap-slot SLOT, replacing any earlier copy for SLOT.  Returns
+   false if the cache is off or full, in which case the page must
+   go to the device. */
+bool
+zcache_store (size_t slot, const void *page) 
+{
+  struct entry *e;
+  const void *data = scratch;
+  size_t size, chunk, chunk_cnt;
+
+  if (entries == NULL)
+    return false;
+  e = &entries[slot];
+
+  lock_acquire (&zcache_lock);
+  release (e);
+  if (is_zero (page))
+    {
+      e->state = ENTRY_ZERO;
+      store_cnt++;
+      zero_cnt++;
+      lock_release (&zcache_lock);
+      return true;
+    }
+
+  size = lz_compress (page, PGSIZE, scratch, PGSIZE - 1, lz_work);
+  if (size == 0)
+    {
+      data = page;
+      size = PGSIZE;
+    }
+  chunk_cnt = DIV_ROUND_UP (size, CHUNK_SIZE);
+  chunk = bitmap_scan_and_flip (chunk_map, 0, chunk_cnt, false);
+  if (chunk == BITMAP_ERROR && grow ())
+    chunk = bitmap_scan_and_flip (chunk_map, 0, chunk_cnt, false);
+  if (chunk == BITMAP_ERROR)
+    {
+      spill_cnt++;
+      lock_release (&zcache_lock);
+      return false;
+    }
+  memcpy (chunk_data (chunk), data, size);
+  used_chunks += chunk_cnt;
+  e->state = ENTRY_DATA;
+  e->size = size;
+  e->chunk = chunk;
+  store_cnt++;
+  data_bytes += size;
+  lock_release (&zcache_lock);
+  return true;
+}
+
+/* Copies the page in swap-slot SLOT into PAGE if the cache holds
+   it, keeping the entry, and returns true.  Returns false if the
+   page is on the device. */
+bool
+zcache_load (size_t slot, void *page) 
+{
+  struct entry *e;
+  bool hit = true;
+
+  if (entries == NULL)
+    return false;
+  e = &entries[slot];
+
+  lock_acquire (&zcache_lock);
+  switch (e->state) 
+    {
+    case ENTRY_ZERO:
+      memset (page, 0, PGSIZE);
+      break;
+
+    case ENTRY_DATA:
+      {
+        const uint8_t *data = chunk_data (e->chunk);
+
+        if (e->size == PGSIZE)
+          memcpy (page, data, PGSIZE);
+        else if (lz_decompress (data, e->size, page, PGSIZE) != PGSIZE)
+          PANIC ("swap cache: slot %zu is corrupt", slot);
+      }
+      break;
+
+    default:
+      hit = false;
+      break;
+    }
+  if (hit)
+    hit_cnt++;
+  else
+    miss_cnt++;
+  lock_release (&zcache_lock);
+  return hit;
+}
+
+/* Forgets the cache's copy of swap-slot SLOT, if any. */
+void
+zcache_drop (size_t slot) 
+{
+  if (entries == NULL)
+    return;
+
+  lock_acquire (&zcache_lock);
+  release (&entries[slot]);
+  lock_release (&zcache_lock);
+}
+
+/* Prints swap cache statistics. */
+void
+zcache_print_stats (void) 
+{
+  long long ratio;
+
+  if (entries == NULL)
+    return;
+
+  /* Zero pages count as taking no space. */
+  ratio = data_bytes > 0 ? store_cnt * PGSIZE * 100 / data_bytes : 0;
+  printf ("Swap cache: %zu kB used in %zu of at most %zu kB, "
+          "%lld pages in (%lld zero), %lld spilled, ratio %lld.%02lld:1\n",
+          used_chunks * CHUNK_SIZE / 1024, used_pages * PGSIZE / 1024,
+          region_pages * PGSIZE / 1024, store_cnt, zero_cnt, spill_cnt,
+          ratio / 100, ratio % 100);
+  printf ("Swap cache: %lld of %lld loads hit (%lld%%)\n",
+          hit_cnt, hit_cnt + miss_cnt,
+          hit_cnt + miss_cnt > 0 ? hit_cnt * 100 / (hit_cnt + miss_cnt) : 0);
+}
+
+/* Frees the data of entry E, leaving it empty, and gives back its
+   region page if that is left empty.  The caller must hold
+   zcache_lock. */
+static void
+release (struct entry *e) 
+{
+  if (e->state == ENTRY_DATA)
+    {
+      size_t chunk_cnt = DIV_ROUND_UP (e->size, CHUNK_SIZE);
+      size_t page = e->chunk / PAGE_STRIDE;
+
+      bitmap_set_multiple (chunk_map, e->chunk, chunk_cnt, false);
+      used_chunks -= chunk_cnt;
+      if (bitmap_none (chunk_map, page * PAGE_STRIDE, PAGE_CHUNKS))
+        {
+          bitmap_set_multiple (chunk_map, page * PAGE_STRIDE, PAGE_CHUNKS,
+                               true);
+          palloc_free_page (region[page]);
+          region[page] = NULL;
+          used_pages--;
+        }
+    }
+  e->state = ENTRY_NONE;
+}
+
+/* Adds a page to the region, if it has not reached its limit and
+   the kernel pool has one to spare, and returns true if it
+   could.  The caller must hold zcache_lock. */
+static bool
+grow (void) 
+{
+  size_t page;
+
+  for (page = 0; page < region_pages; page++)
+    if (region[page] == NULL)
+      {
+        region[page] = palloc_get_page (0);
+        if (region[page] == NULL)
+          return false;
+        bitmap_set_multiple (chunk_map, page * PAGE_STRIDE, PAGE_CHUNKS,
+                             false);
+        used_pages++;
+        return true;
+      }
+  return false;
+}
+
+/* Returns the address of CHUNK in the region. */
+static uint8_t *
+chunk_data (size_t chunk) 
+{
+  return region[chunk / PAGE_STRIDE] + chunk % PAGE_STRIDE * CHUNK_SIZE;
+}
+
+/* Returns true if PAGE is all zeros. */
+static bool
+is_zero (const void *page) 
+{
+  const uint32_t *p = page;
+  size_t i;
+
+  for (i = 0; i < PGSIZE / sizeof *p; i++)
+    if (p[i] != 0)
+      return false;
+  return true;
+}
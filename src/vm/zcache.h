@@ -0,0 +1,16 @@
+#ifndef VM_ZCACHE_H
+#define VM_ZCACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Size the cache may grow to, in percent of the user pool. */
+extern unsigned zcache_percent;
+
+void zcache_init (size_t slot_cnt);
+bool zcache_store (size_t slot, const void *page);
+bool zcache_load (size_t slot, void *page);
+void zcache_drop (size_t slot);
+void zcache_print_stats (void);
+
+#endif /* vm/zcache.h */